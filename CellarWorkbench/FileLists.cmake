@@ -54,6 +54,7 @@ SET(CELLAR_MISC_HEADERS
     ${CELLAR_SRC_DIR}/Misc/Log.h
     ${CELLAR_SRC_DIR}/Misc/FastMath.h
     ${CELLAR_SRC_DIR}/Misc/Distribution.h
+    ${CELLAR_SRC_DIR}/Misc/CpuTopology.h
     ${CELLAR_SRC_DIR}/Misc/SimplexNoise.h
     ${CELLAR_SRC_DIR}/Misc/StringUtils.h)
 
@@ -133,6 +134,7 @@ SET(CELLAR_MISC_SOURCES
     ${CELLAR_SRC_DIR}/Misc/Log.cpp
     ${CELLAR_SRC_DIR}/Misc/FastMath.cpp
     ${CELLAR_SRC_DIR}/Misc/Distribution.cpp
+    ${CELLAR_SRC_DIR}/Misc/CpuTopology.cpp
     ${CELLAR_SRC_DIR}/Misc/SimplexNoise.cpp
     ${CELLAR_SRC_DIR}/Misc/StringUtils.cpp)
 
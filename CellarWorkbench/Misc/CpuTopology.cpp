@@ -0,0 +1,266 @@
+#include "CpuTopology.h"
+
+#include <map>
+#include <tuple>
+#include <sstream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <fstream>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace cellar
+{
+#ifdef __linux__
+    const std::string SYSFS_CPU_DIR = "/sys/devices/system/cpu/";
+    const std::string SYSFS_NODE_DIR = "/sys/devices/system/node/";
+
+    static std::string readLine(const std::string& path)
+    {
+        std::string line;
+        std::ifstream file(path);
+        std::getline(file, line);
+        return line;
+    }
+
+    static int readInt(const std::string& path, int defaultValue)
+    {
+        std::istringstream line(readLine(path));
+        int value = defaultValue;
+        if(!(line >> value))
+            return defaultValue;
+        return value;
+    }
+
+    // Parses kernel's cpu lists, such as "0-3,8-11"
+    static std::vector<unsigned int> parseCpuList(const std::string& list)
+    {
+        std::vector<unsigned int> cpus;
+        std::istringstream stream(list);
+        std::string range;
+        while(std::getline(stream, range, ','))
+        {
+            unsigned int beg = 0, end = 0;
+            char dash = 0;
+            std::istringstream rangeStream(range);
+            if(!(rangeStream >> beg))
+                continue;
+            if(!(rangeStream >> dash >> end) || dash != '-')
+                end = beg;
+
+            for(unsigned int c=beg; c <= end; ++c)
+                cpus.push_back(c);
+        }
+
+        return cpus;
+    }
+#endif
+
+    static std::string formatCpuList(const std::vector<unsigned int>& cpus)
+    {
+        std::string list;
+        for(size_t i=0; i < cpus.size();)
+        {
+            size_t j = i;
+            while(j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1)
+                ++j;
+
+            if(!list.empty())
+                list += ",";
+            list += std::to_string(cpus[i]);
+            if(j > i)
+                list += "-" + std::to_string(cpus[j]);
+
+            i = j + 1;
+        }
+
+        return list;
+    }
+
+
+    CpuTopology::CpuTopology() :
+        _coreCount(0),
+        _packageCount(0),
+        _nodeCount(0)
+    {
+
+    }
+
+    void CpuTopology::detect()
+    {
+        _cpus.clear();
+
+#ifdef __linux__
+        // Processors the process was restricted to are left out
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool hasMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        std::map<unsigned int, unsigned int> cpuNodes;
+        DIR* nodeDir = opendir(SYSFS_NODE_DIR.c_str());
+        if(nodeDir != nullptr)
+        {
+            while(dirent* entry = readdir(nodeDir))
+            {
+                std::string name = entry->d_name;
+                if(name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+                   name.find_first_not_of("0123456789", 4) != std::string::npos)
+                    continue;
+
+                unsigned int nodeId = std::stoul(name.substr(4));
+                std::string cpuList = readLine(SYSFS_NODE_DIR + name + "/cpulist");
+                for(unsigned int cpu : parseCpuList(cpuList))
+                    cpuNodes[cpu] = nodeId;
+            }
+
+            closedir(nodeDir);
+        }
+
+        for(unsigned int cpu : parseCpuList(readLine(SYSFS_CPU_DIR + "online")))
+        {
+            if(hasMask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)))
+                continue;
+
+            std::string topoDir = SYSFS_CPU_DIR + "cpu" + std::to_string(cpu) + "/topology/";
+            int coreId = readInt(topoDir + "core_id", int(cpu));
+            int packageId = readInt(topoDir + "physical_package_id", 0);
+
+            LogicalCpu logicalCpu;
+            logicalCpu.cpuId = cpu;
+            logicalCpu.coreId = (unsigned int) std::max(coreId, 0);
+            logicalCpu.packageId = (unsigned int) std::max(packageId, 0);
+            logicalCpu.nodeId = cpuNodes.count(cpu) ? cpuNodes[cpu] : 0;
+            _cpus.push_back(logicalCpu);
+        }
+#endif
+
+        if(_cpus.empty())
+        {
+            // hardware_concurrency is only a hint on the number of cores
+            unsigned int cpuCount = std::max(std::thread::hardware_concurrency(), 1u);
+            for(unsigned int cpu=0; cpu < cpuCount; ++cpu)
+                _cpus.push_back(LogicalCpu{cpu, cpu, 0, 0});
+        }
+
+        // Number cores, packages and nodes contiguously. Core ids
+        // are only unique within their package.
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> coreIds;
+        std::map<unsigned int, unsigned int> packageIds;
+        std::map<unsigned int, unsigned int> nodeIds;
+        for(LogicalCpu& cpu : _cpus)
+        {
+            auto core = std::make_pair(cpu.packageId, cpu.coreId);
+            if(!coreIds.count(core))
+                coreIds[core] = (unsigned int) coreIds.size();
+            if(!packageIds.count(cpu.packageId))
+                packageIds[cpu.packageId] = (unsigned int) packageIds.size();
+            if(!nodeIds.count(cpu.nodeId))
+                nodeIds[cpu.nodeId] = (unsigned int) nodeIds.size();
+
+            cpu.coreId = coreIds[core];
+            cpu.packageId = packageIds[cpu.packageId];
+            cpu.nodeId = nodeIds[cpu.nodeId];
+        }
+
+        _coreCount = (unsigned int) coreIds.size();
+        _packageCount = (unsigned int) packageIds.size();
+        _nodeCount = (unsigned int) nodeIds.size();
+    }
+
+    std::vector<LogicalCpu> CpuTopology::placeThreads(size_t threadCount) const
+    {
+        std::vector<LogicalCpu> placement;
+        if(_cpus.empty())
+            return placement;
+
+        // Rank of processors among their core's siblings,
+        // and rank of cores among their node's cores
+        std::vector<std::tuple<unsigned int, unsigned int, unsigned int>> ranks;
+        std::map<unsigned int, unsigned int> coreSiblingCounts;
+        std::map<unsigned int, unsigned int> coreRanks;
+        std::vector<unsigned int> nodeCoreCounts(_nodeCount, 0);
+        for(const LogicalCpu& cpu : _cpus)
+        {
+            unsigned int siblingRank = coreSiblingCounts[cpu.coreId]++;
+            if(siblingRank == 0)
+                coreRanks[cpu.coreId] = nodeCoreCounts[cpu.nodeId]++;
+
+            ranks.push_back(std::make_tuple(
+                siblingRank, coreRanks[cpu.coreId], cpu.nodeId));
+        }
+
+        std::vector<size_t> order(_cpus.size());
+        for(size_t i=0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(),
+            [&ranks](size_t c1, size_t c2){
+                return ranks[c1] < ranks[c2];
+        });
+
+        for(size_t t=0; t < threadCount; ++t)
+            placement.push_back(_cpus[order[t % order.size()]]);
+
+        return placement;
+    }
+
+    std::string CpuTopology::report() const
+    {
+        std::string report =
+            std::to_string(_cpus.size()) + " logical CPUs on " +
+            std::to_string(_coreCount) + " cores, " +
+            std::to_string(_packageCount) + " packages and " +
+            std::to_string(_nodeCount) + " NUMA nodes";
+
+        for(unsigned int n=0; n < _nodeCount; ++n)
+        {
+            std::vector<unsigned int> nodeCpus;
+            for(const LogicalCpu& cpu : _cpus)
+            {
+                if(cpu.nodeId == n)
+                    nodeCpus.push_back(cpu.cpuId);
+            }
+
+            report += "\nNode " + std::to_string(n) +
+                      " : CPUs " + formatCpuList(nodeCpus);
+        }
+
+        return report;
+    }
+
+    bool CpuTopology::pinThread(std::thread& thread, unsigned int cpuId)
+    {
+#ifdef __linux__
+        if(cpuId >= CPU_SETSIZE)
+            return false;
+
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpuId, &cpuSet);
+        return pthread_setaffinity_np(thread.native_handle(),
+                                      sizeof(cpuSet), &cpuSet) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool CpuTopology::pinCurrentThread(unsigned int cpuId)
+    {
+#ifdef __linux__
+        if(cpuId >= CPU_SETSIZE)
+            return false;
+
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpuId, &cpuSet);
+        return pthread_setaffinity_np(pthread_self(),
+                                      sizeof(cpuSet), &cpuSet) == 0;
+#else
+        return false;
+#endif
+    }
+}
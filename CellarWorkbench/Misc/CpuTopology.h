@@ -0,0 +1,82 @@
+#ifndef CELLARWORKBENCH_CPUTOPOLOGY_H
+#define CELLARWORKBENCH_CPUTOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "../libCellarWorkbench_global.h"
+
+
+namespace cellar
+{
+    // Logical processor, numbered as by the operating system.
+    // Cores and nodes are numbered from 0 across the machine.
+    struct CELLAR_EXPORT LogicalCpu
+    {
+        unsigned int cpuId;
+        unsigned int coreId;
+        unsigned int packageId;
+        unsigned int nodeId;
+    };
+
+    // Logical processors, physical cores and NUMA nodes the process
+    // may run on. Read from sysfs on Linux. Elsewhere, each logical
+    // processor is taken as its own core of a single node.
+    class CELLAR_EXPORT CpuTopology
+    {
+    public:
+        CpuTopology();
+
+        void detect();
+
+        const std::vector<LogicalCpu>& cpus() const;
+        unsigned int coreCount() const;
+        unsigned int packageCount() const;
+        unsigned int nodeCount() const;
+
+        // Processors for threadCount threads. Every physical core
+        // gets a thread before any gets a second one, and threads are
+        // spread evenly over nodes so that their memory bandwidth
+        // adds up. Processors are reused past the processor count.
+        std::vector<LogicalCpu> placeThreads(size_t threadCount) const;
+
+        std::string report() const;
+
+        // Restrict a thread to a single logical processor.
+        // Return false where thread affinity is not supported.
+        static bool pinThread(std::thread& thread, unsigned int cpuId);
+        static bool pinCurrentThread(unsigned int cpuId);
+
+    private:
+        std::vector<LogicalCpu> _cpus;
+        unsigned int _coreCount;
+        unsigned int _packageCount;
+        unsigned int _nodeCount;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline const std::vector<LogicalCpu>& CpuTopology::cpus() const
+    {
+        return _cpus;
+    }
+
+    inline unsigned int CpuTopology::coreCount() const
+    {
+        return _coreCount;
+    }
+
+    inline unsigned int CpuTopology::packageCount() const
+    {
+        return _packageCount;
+    }
+
+    inline unsigned int CpuTopology::nodeCount() const
+    {
+        return _nodeCount;
+    }
+}
+
+#endif // CELLARWORKBENCH_CPUTOPOLOGY_H
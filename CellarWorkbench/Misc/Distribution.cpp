@@ -1,61 +1,162 @@
 #include "Distribution.h"
 
-#include <stdlib.h>
+#include <atomic>
 
 
 namespace cellar
 {
-    RandomArray g_masterRandomArray;
+    // Philox constants from Salmon et al., "Parallel Random Numbers:
+    // As Easy as 1, 2, 3" (Random123)
+    const uint32_t PHILOX_M0 = 0xD2511F53;
+    const uint32_t PHILOX_M1 = 0xCD9E8D57;
+    const uint32_t PHILOX_W0 = 0x9E3779B9;
+    const uint32_t PHILOX_W1 = 0xBB67AE85;
+    const int PHILOX_ROUND_COUNT = 10;
 
-    RandomArray::RandomArray() :
-        _array(nullptr)
+    const uint32_t PHILOX_SEED = 0x5EED0001;
+
+    // Pair seeds are shared by all threads : a pixel's samples
+    // may be shot by any of them
+    const uint32_t PAIR_SEED = 0x5EED0002;
+
+    // Generalized golden ratio's powers (Roberts' R2 sequence)
+    const uint32_t RANK1_ALPHA0 = 0xC13FA9A9;
+    const uint32_t RANK1_ALPHA1 = 0x91E10DA5;
+
+    const double UINT32_TO_UNIT = 1.0 / 4294967296.0;
+
+    // Threads that never pick a stream get one of their own
+    std::atomic<uint32_t> g_nextThreadStream(0x80000000u);
+
+
+    void CounterRand::philox(uint32_t counter[4], uint32_t key[2])
+    {
+        for(int r=0; r < PHILOX_ROUND_COUNT; ++r)
+        {
+            uint64_t prod0 = uint64_t(PHILOX_M0) * counter[0];
+            uint64_t prod1 = uint64_t(PHILOX_M1) * counter[2];
+            uint32_t hi0 = uint32_t(prod0 >> 32), lo0 = uint32_t(prod0);
+            uint32_t hi1 = uint32_t(prod1 >> 32), lo1 = uint32_t(prod1);
+
+            counter[0] = hi1 ^ counter[1] ^ key[0];
+            counter[1] = lo1;
+            counter[2] = hi0 ^ counter[3] ^ key[1];
+            counter[3] = lo0;
+
+            key[0] += PHILOX_W0;
+            key[1] += PHILOX_W1;
+        }
+    }
+
+    double CounterRand::gen1(
+            uint32_t stream,
+            uint32_t pixel,
+            uint32_t sample,
+            uint32_t bounce,
+            uint32_t dimension)
     {
+        uint32_t counter[4] = {pixel, sample, bounce, dimension};
+        uint32_t key[2] = {PHILOX_SEED, stream};
+        philox(counter, key);
+
+        // 53 random bits
+        uint64_t a = counter[0] >> 5;
+        uint64_t b = counter[1] >> 6;
+        return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+    }
 
+    inline uint32_t reverseBits(uint32_t x)
+    {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ff) << 8) | ((x & 0xff00ff00) >> 8);
+        x = ((x & 0x0f0f0f0f) << 4) | ((x & 0xf0f0f0f0) >> 4);
+        x = ((x & 0x33333333) << 2) | ((x & 0xcccccccc) >> 2);
+        x = ((x & 0x55555555) << 1) | ((x & 0xaaaaaaaa) >> 1);
+        return x;
     }
 
-    RandomArray::~RandomArray()
+    // Laine-Karras hash, only flipping bits from lower bits, applied
+    // to reversed bits : nested uniform scrambling (Burley 2020)
+    inline uint32_t owenScramble(uint32_t x, uint32_t seed)
     {
-        deallocate();
+        x = reverseBits(x);
+        x += seed;
+        x ^= x * 0x6c50b47c;
+        x ^= x * 0xb82f1e52;
+        x ^= x * 0xc7afe638;
+        x ^= x * 0x8d22f6e6;
+        return reverseBits(x);
     }
 
-    void RandomArray::allocate()
+    glm::dvec2 CounterRand::sobol2(uint32_t index, const uint32_t seeds[3])
     {
-        if(_array == nullptr)
+        index = owenScramble(index, seeds[0]);
+
+        // First dimension is van der Corput's radical inverse
+        uint32_t x = reverseBits(index);
+
+        // Second dimension's direction numbers come from x + 1
+        uint32_t y = 0;
+        for(uint32_t v = 0x80000000; index != 0; index >>= 1, v ^= v >> 1)
         {
-            size_t arraySize = 1 << (sizeof(decltype(_sharedIdx)) * 8);
-            _array = new double[arraySize];
-            refill();
+            if(index & 1)
+                y ^= v;
         }
+
+        x = owenScramble(x, seeds[1]);
+        y = owenScramble(y, seeds[2]);
+        return glm::dvec2(x, y) * UINT32_TO_UNIT;
     }
 
-    void RandomArray::refill()
+    glm::dvec2 CounterRand::rank1(uint32_t index, const uint32_t seeds[2])
     {
-        size_t arraySize = 1 << (sizeof(decltype(_sharedIdx)) * 8);
+        // Wrapping arithmetic takes the fractional part
+        uint32_t x = seeds[0] + index * RANK1_ALPHA0;
+        uint32_t y = seeds[1] + index * RANK1_ALPHA1;
+        return glm::dvec2(x, y) * UINT32_TO_UNIT;
+    }
 
-        /*
-        std::random_device rd;
-        std::mt19937_64 gen(rd());
-        std::uniform_real_distribution<double> dis(0.0, 1.0);
 
-        for(size_t i=0; i < arraySize; ++i)
-            _array[i] = dis(gen);
-        /*/
+    RandomStream::RandomStream(uint32_t stream) :
+        _sequence(Sequence::WHITE_NOISE),
+        _stream(stream),
+        _pixel(0),
+        _sample(0),
+        _bounce(0),
+        _dimension(0),
+        _pair(0)
+    {
 
-        srand(0);
+    }
+
+    glm::dvec2 RandomStream::nextPair()
+    {
+        if(_sequence == Sequence::WHITE_NOISE)
+        {
+            double x = next();
+            double y = next();
+            return glm::dvec2(x, y);
+        }
 
-        for(size_t i=0; i < arraySize; ++i)
-            _array[i] = rand() / double(RAND_MAX);
-        //*/
+        // Sample index is left out of the seeds
+        uint32_t seeds[4] = {_pixel, _bounce, _pair++, 0};
+        uint32_t key[2] = {PHILOX_SEED, PAIR_SEED};
+        CounterRand::philox(seeds, key);
+
+        if(_sequence == Sequence::SOBOL)
+            return CounterRand::sobol2(_sample, seeds);
+        else
+            return CounterRand::rank1(_sample, seeds);
     }
 
-    void RandomArray::deallocate()
+    RandomStream& RandomStream::local()
     {
-        delete[] _array;
-        _array = nullptr;
+        static thread_local RandomStream stream(g_nextThreadStream++);
+        return stream;
     }
 
-    LinearRand::LinearRand() :
-        _randArrayIdx(0)
+
+    LinearRand::LinearRand()
     {
 
     }
@@ -66,8 +167,19 @@ namespace cellar
     }
 
 
+    StratifiedRand::StratifiedRand()
+    {
+
+    }
+
+    StratifiedRand::~StratifiedRand()
+    {
+
+    }
+
+
     DiskRand::DiskRand() :
-        _linearRand()
+        _stratifiedRand()
     {
 
     }
@@ -2,6 +2,7 @@
 #define CELLARWORKBENCH_DISTRIBUTION_H
 
 #include <random>
+#include <cstdint>
 
 #include <GLM/glm.hpp>
 #include <GLM/gtc/constants.hpp>
@@ -11,26 +12,68 @@
 
 namespace cellar
 {
-    class CELLAR_EXPORT RandomArray
+    // Stateless counter-based generator (Philox-4x32-10).
+    // Coordinates are hashed, so any of them can be drawn in any
+    // order, from any thread, without shared state.
+    class CELLAR_EXPORT CounterRand
     {
     public:
-        RandomArray();
-        ~RandomArray();
+        // Uniform value in [0, 1)
+        static double gen1(
+                uint32_t stream,
+                uint32_t pixel,
+                uint32_t sample,
+                uint32_t bounce,
+                uint32_t dimension);
+
+        static void philox(uint32_t counter[4], uint32_t key[2]);
+
+        // Owen scrambled 2D Sobol point. Index is shuffled by the
+        // first seed, each coordinate is scrambled by its own seed.
+        static glm::dvec2 sobol2(uint32_t index, const uint32_t seeds[3]);
+
+        // Rank-1 lattice point (R2 sequence) shifted by two seeds
+        static glm::dvec2 rank1(uint32_t index, const uint32_t seeds[2]);
+    };
+
+
+    // Position of a thread in the sample space. Distributions draw
+    // their numbers from the calling thread's stream.
+    class CELLAR_EXPORT RandomStream
+    {
+    public:
+        // Sequence of the stratified pairs. Low-discrepancy sequences
+        // need samples to be numbered contiguously within a pixel.
+        enum class Sequence {WHITE_NOISE, SOBOL, RANK1_LATTICE};
+
+        RandomStream(uint32_t stream);
 
-        void allocate();
-        void refill();
-        void deallocate();
+        void setSequence(Sequence sequence);
+        Sequence sequence() const;
+
+        // Starts a new sample, at its first bounce
+        void setSample(uint32_t pixel, uint32_t sample);
+        void setBounce(uint32_t bounce);
 
         double next();
-        double next(unsigned short& idx);
+
+        // Each pair of a sample's bounce has its own sequence,
+        // decorrelated from other pixels' and other pairs' ones
+        glm::dvec2 nextPair();
+
+        // Calling thread's own stream
+        static RandomStream& local();
 
     private:
-        double* _array;
-        mutable unsigned short _sharedIdx;
+        Sequence _sequence;
+        uint32_t _stream;
+        uint32_t _pixel;
+        uint32_t _sample;
+        uint32_t _bounce;
+        uint32_t _dimension;
+        uint32_t _pair;
     };
 
-    CELLAR_EXPORT extern RandomArray g_masterRandomArray;
-
 
 
     class CELLAR_EXPORT LinearRand
@@ -50,10 +93,17 @@ namespace cellar
         glm::dvec3 gen3() const;
         glm::dvec3 gen3(glm::dvec3 maxVal) const;
         glm::dvec3 gen3(glm::dvec3 minVal, glm::dvec3 maxVal) const;
+    };
 
 
-    private:
-        mutable unsigned short _randArrayIdx;
+    // Pairs drawn from the stream's sequence
+    class CELLAR_EXPORT StratifiedRand
+    {
+    public:
+        StratifiedRand();
+        ~StratifiedRand();
+
+        glm::dvec2 gen2() const;
     };
 
 
@@ -70,7 +120,7 @@ namespace cellar
 
 
     private:
-        LinearRand _linearRand;
+        StratifiedRand _stratifiedRand;
     };
 
 
@@ -94,31 +144,50 @@ namespace cellar
 
 
     // IMPLEMENTATION //
-    inline double RandomArray::next()
+    inline void RandomStream::setSequence(Sequence sequence)
+    {
+        _sequence = sequence;
+    }
+
+    inline RandomStream::Sequence RandomStream::sequence() const
     {
-        assert(_array != nullptr);
-        return _array[++_sharedIdx];
+        return _sequence;
     }
 
-    inline double RandomArray::next(unsigned short& idx)
+    inline void RandomStream::setSample(uint32_t pixel, uint32_t sample)
     {
-        assert(_array != nullptr);
-        return _array[++idx];
+        _pixel = pixel;
+        _sample = sample;
+        _bounce = 0;
+        _dimension = 0;
+        _pair = 0;
+    }
+
+    inline void RandomStream::setBounce(uint32_t bounce)
+    {
+        _bounce = bounce;
+        _dimension = 0;
+        _pair = 0;
+    }
+
+    inline double RandomStream::next()
+    {
+        return CounterRand::gen1(_stream, _pixel, _sample, _bounce, _dimension++);
     }
 
     inline double LinearRand::gen1() const
     {
-        return g_masterRandomArray.next(_randArrayIdx);
+        return RandomStream::local().next();
     }
 
     inline double LinearRand::gen1(double maxVal) const
     {
-        return g_masterRandomArray.next(_randArrayIdx) * maxVal;
+        return RandomStream::local().next() * maxVal;
     }
 
     inline double LinearRand::gen1(double minVal, double maxVal) const
     {
-        return g_masterRandomArray.next(_randArrayIdx) * (maxVal - minVal) + minVal;
+        return RandomStream::local().next() * (maxVal - minVal) + minVal;
     }
 
     inline glm::dvec2 LinearRand::gen2() const
@@ -153,11 +222,16 @@ namespace cellar
                           gen1(minVal.y, maxVal.y),
                           gen1(minVal.z, maxVal.z));
     }
+
+    inline glm::dvec2 StratifiedRand::gen2() const
+    {
+        return RandomStream::local().nextPair();
+    }
+
     inline glm::dvec2 DiskRand::gen(double radius) const
     {
-        return gen(radius,
-                   _linearRand.gen1(),
-                   _linearRand.gen1(2.0 * glm::pi<double>()));
+        glm::dvec2 pair = _stratifiedRand.gen2();
+        return gen(radius, pair.x, pair.y * (2.0 * glm::pi<double>()));
     }
 
     inline glm::dvec2 DiskRand::gen(
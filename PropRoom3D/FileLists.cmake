@@ -67,8 +67,10 @@ SET(PROP3_NODE_HEADERS
 # Rays
 SET(PROP3_RAY_HEADERS
     ${PROP3_SRC_DIR}/Ray/Raycast.h
+    ${PROP3_SRC_DIR}/Ray/AxisAlignedBox.h
     ${PROP3_SRC_DIR}/Ray/RayHitList.h
-    ${PROP3_SRC_DIR}/Ray/RayHitReport.h)
+    ${PROP3_SRC_DIR}/Ray/RayHitReport.h
+    ${PROP3_SRC_DIR}/Ray/RayPacket.h)
 
 # Serialization
 SET(PROP3_SERIAL_HEADERS
@@ -80,6 +82,10 @@ SET(PROP3_SERIAL_HEADERS
 SET(PROP3_FILM_HEADERS
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/Film.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/Tile.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/TileScheduler.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/ScratchTile.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/FilmPlanes.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/RawFilmFile.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/ConvergentFilm.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/NetworkFilm.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/StaticFilm.h
@@ -103,9 +109,12 @@ SET(PROP3_ART_DIRECTOR_HEADERS
     ${PROP3_SRC_DIR}/Team/ArtDirector/DebugRenderer.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/CpuRaytracerEngine.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/CpuRaytracerWorker.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/CpuWavefrontWorker.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/GlPostProdUnit.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/LightTree.h
     ${PROP3_SRC_DIR}/Team/ArtDirector/RaytracerState.h
-    ${PROP3_SRC_DIR}/Team/ArtDirector/SearchStructure.h)
+    ${PROP3_SRC_DIR}/Team/ArtDirector/SearchStructure.h
+    ${PROP3_SRC_DIR}/Team/ArtDirector/SurfaceProgram.h)
 
 # Choreographer
 SET(PROP3_CHOREOGRAPHER_HEADERS
@@ -199,8 +208,10 @@ SET(PROP3_NODE_SOURCES
 # Rays
 SET(PROP3_RAY_SOURCES
     ${PROP3_SRC_DIR}/Ray/Raycast.cpp
+    ${PROP3_SRC_DIR}/Ray/AxisAlignedBox.cpp
     ${PROP3_SRC_DIR}/Ray/RayHitList.cpp
-    ${PROP3_SRC_DIR}/Ray/RayHitReport.cpp)
+    ${PROP3_SRC_DIR}/Ray/RayHitReport.cpp
+    ${PROP3_SRC_DIR}/Ray/RayPacket.cpp)
 
 # Serialization
 SET(PROP3_SERIAL_SOURCES
@@ -212,6 +223,9 @@ SET(PROP3_SERIAL_SOURCES
 SET(PROP3_FILM_SOURCES
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/Film.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/Tile.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/TileScheduler.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/ScratchTile.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/Film/RawFilmFile.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/NetworkFilm.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/ConvergentFilm.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/Film/StaticFilm.cpp
@@ -234,9 +248,12 @@ SET(PROP3_ART_DIRECTOR_SOURCES
     ${PROP3_SRC_DIR}/Team/ArtDirector/DebugRenderer.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/CpuRaytracerEngine.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/CpuRaytracerWorker.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/CpuWavefrontWorker.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/GlPostProdUnit.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/LightTree.cpp
     ${PROP3_SRC_DIR}/Team/ArtDirector/RaytracerState.cpp
-    ${PROP3_SRC_DIR}/Team/ArtDirector/SearchStructure.cpp)
+    ${PROP3_SRC_DIR}/Team/ArtDirector/SearchStructure.cpp
+    ${PROP3_SRC_DIR}/Team/ArtDirector/SurfaceProgram.cpp)
 
 # Choreographer
 SET(PROP3_CHOREOGRAPHER_SOURCES
@@ -99,6 +99,21 @@ namespace prop3
         return span;
     }
 
+    double CircularLight::castDensity(
+            const glm::dvec3& source,
+            const glm::dvec3& pos) const
+    {
+        glm::dvec3 dir = pos - source;
+        double dist2 = glm::dot(dir, dir);
+        double cosine = glm::dot(dir, glm::normalize(_transformN)) / glm::sqrt(dist2);
+
+        if(!(cosine > 0.0))
+            return 0.0;
+
+        // Sources are uniformly distributed over the disk
+        return dist2 / (area() * cosine);
+    }
+
     void CircularLight::onTransform()
     {
         _transformC = glm::dvec3(_transform * glm::dvec4(_center, 1.0));
@@ -36,6 +36,10 @@ namespace prop3
 
         virtual double visibility(const Raycast& ray) const override;
 
+        virtual double castDensity(
+                const glm::dvec3& source,
+                const glm::dvec3& pos) const override;
+
 
         glm::dvec3 center() const;
 
@@ -55,6 +55,12 @@ namespace prop3
 
         virtual double visibility(const Raycast& ray) const = 0;
 
+        // Solid angle density, seen from pos, at which a single cast
+        // of fireOn() leaves from source. Zero if it can't.
+        virtual double castDensity(
+                const glm::dvec3& source,
+                const glm::dvec3& pos) const = 0;
+
         virtual void setIsOn(bool isOn);
         bool isOn() const;
 
@@ -81,6 +81,23 @@ namespace prop3
         return span;
     }
 
+    double SphericalLight::castDensity(
+            const glm::dvec3& source,
+            const glm::dvec3& pos) const
+    {
+        glm::dvec3 dir = pos - source;
+        double dist2 = glm::dot(dir, dir);
+        glm::dvec3 normal = glm::normalize(source - _transformC);
+        double cosine = glm::dot(dir, normal) / glm::sqrt(dist2);
+
+        if(!(cosine > 0.0))
+            return 0.0;
+
+        // Sources facing away from pos are mirrored,
+        // doubling the density of the facing half
+        return dist2 / (area() / 2.0 * cosine);
+    }
+
     void SphericalLight::onTransform()
     {
         _transformC = glm::dvec3(_transform * glm::dvec4(_center, 1.0));
@@ -10,7 +10,8 @@ namespace prop3
         raycast(raycast),
         emittingPosition(emittingPosition),
         emittingDirection(emittingDirection),
-        diffuseSize(diffuseSize)
+        diffuseSize(diffuseSize),
+        density(0.0)
     {
 
     }
@@ -24,6 +24,11 @@ namespace prop3
         glm::dvec3 emittingPosition;
         glm::dvec3 emittingDirection;
         DiffuseSize diffuseSize;
+
+        // Solid angle density at which the light's sampling reaches
+        // the lit point from emittingPosition, over all its casts.
+        // Zero if light sampling doesn't compete with coatings.
+        double density;
     };
 }
 
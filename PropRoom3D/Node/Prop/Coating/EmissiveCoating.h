@@ -34,10 +34,20 @@ namespace prop3
         virtual glm::dvec3 albedo(
                 const RayHitReport& report) const override;
 
+        const LightBulb& lightBulb() const;
+
 
     private:
         const LightBulb& _lightBulb;
     };
+
+
+
+    // IMPLEMENTATION //
+    inline const LightBulb& EmissiveCoating::lightBulb() const
+    {
+        return _lightBulb;
+    }
 }
 
 #endif // PROPROOM3D_EMITTERCOATING_H
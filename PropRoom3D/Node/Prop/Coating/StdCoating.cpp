@@ -149,11 +149,14 @@ namespace prop3
                 glm::dvec3 diffuseDir = glm::reflect(
                         incident, diffuseNormal);
 
-                raycasts.push_back(Raycast(
+                Raycast diffuseRay(
                         Raycast::FULLY_DIFFUSE,
                         diffuseSample,
                         reflectOrig,
-                        diffuseDir));
+                        diffuseDir);
+                diffuseRay.density = lobeDensity(
+                        wallNormal, incident, 1.0, diffuseDir);
+                raycasts.push_back(diffuseRay);
             }
             else
             {
@@ -167,11 +170,14 @@ namespace prop3
             glm::dvec3 reflectDir = glm::reflect(
                     incident, reflectNormal);
 
-            raycasts.push_back(Raycast(
+            Raycast reflectRay(
                     entropy,
                     reflectSample,
                     reflectOrig,
-                    reflectDir));
+                    reflectDir);
+            reflectRay.density = lobeDensity(
+                    wallNormal, incident, rough, reflectDir);
+            raycasts.push_back(reflectRay);
         }
 
         // No emission
@@ -206,6 +212,13 @@ namespace prop3
         // Geometry
         glm::dvec3 wallNormal = report.normal;
         glm::dvec3 outDir = -eyeRay.direction;
+
+        // Reflection lobes also reach the light
+        glm::dvec3 lightDir = -incident;
+        double diffuseDensity = lobeDensity(report.normal,
+            eyeRay.direction, glm::max(rough, 1.0), lightDir);
+        double reflectDensity = lobeDensity(report.normal,
+            eyeRay.direction, rough, lightDir);
         double inDotNorm = -glm::dot(incident, wallNormal);
         double outDotNorm = glm::dot(outDir, wallNormal);
         bool isTransmission = outDotNorm < 0.0;
@@ -245,7 +258,8 @@ namespace prop3
                 glm::dvec3 pColor = glm::dvec3(paintFrag);
                 glm::dvec3 diffuseColor = glm::mix(pColor, eColor, matDiffProb / diffuseProb);
                 glm::dvec4 diffSample(diffuseColor * diffuseWeight, diffuseWeight);
-                sampleSum += diffSample;
+                sampleSum += diffSample * Raycast::powerHeuristic(
+                    lightCast.density, diffuseDensity);
             }
 
             if(reflectProb > 0.0 && rough > 0.0)
@@ -262,7 +276,8 @@ namespace prop3
 
                 glm::dvec3 reflectColor = glm::mix(color::white, eColor, metalProb / reflectProb);
                 glm::dvec4 reflectSample(reflectColor * reflectWeight, reflectWeight);
-                sampleSum += reflectSample;
+                sampleSum += reflectSample * Raycast::powerHeuristic(
+                    lightCast.density, reflectDensity);
             }
         }
         else if(rough > 0.0 && eOpa < 1.0)
@@ -306,8 +321,9 @@ namespace prop3
         if(rough <= 0.0)
             return wallNormal;
 
-        double phi = _linearRand.gen1(2.0 * glm::pi<double>());
-        double zee = cellar::fast_pow(_linearRand.gen1(), 1.0 / (1.0/rough + 1.0));
+        glm::dvec2 pair = _stratifiedRand.gen2();
+        double phi = pair.x * (2.0 * glm::pi<double>());
+        double zee = cellar::fast_pow(pair.y, 1.0 / (1.0/rough + 1.0));
         double rad = glm::sqrt(1.0 - zee*zee);
 
         double c = glm::cos(phi);
@@ -327,4 +343,27 @@ namespace prop3
         glm::dvec3 normal = glm::normalize(glm::normalize(diffuse) - incidentDir);
         return normal;
     }
+
+    double StdCoating::lobeDensity(
+            const glm::dvec3& wallNormal,
+            const glm::dvec3& incidentDir,
+            double rough,
+            const glm::dvec3& direction) const
+    {
+        if(rough <= 0.0)
+            return 0.0;
+
+        // Microfacet normals reflect incident rays exactly
+        // along the sampled 'diffuse' direction
+        glm::dvec3 specular = glm::reflect(incidentDir, wallNormal);
+        glm::dvec3 center = glm::normalize(glm::mix(specular, wallNormal, rough));
+
+        double cosine = glm::dot(direction, center);
+        if(cosine <= 0.0)
+            return 0.0;
+
+        double exponent = 1.0 / rough;
+        return (exponent + 1.0) / (2.0 * glm::pi<double>()) *
+                cellar::fast_pow(cosine, exponent);
+    }
 }
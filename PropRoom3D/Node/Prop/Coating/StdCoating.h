@@ -43,7 +43,16 @@ namespace prop3
                 const glm::dvec3& incidentDir,
                 double rough) const;
 
-        cellar::LinearRand _linearRand;
+        // Solid angle density of the reflections sampled by
+        // getMicrofacetNormal(), as a Phong lobe around their center.
+        // Zero for the singular specular lobe.
+        double lobeDensity(
+                const glm::dvec3& wallNormal,
+                const glm::dvec3& incidentDir,
+                double rough,
+                const glm::dvec3& direction) const;
+
+        cellar::StratifiedRand _stratifiedRand;
     };
 }
 
@@ -33,8 +33,7 @@ namespace prop3
         else
         {
             double scatterRate = 1 / (1 / (opa) - 1);
-            std::exponential_distribution<> distrib(scatterRate);
-            return distrib(_randomEngine);
+            return -glm::log(1.0 - _linearRand.gen1()) / scatterRate;
         }
     }
 
@@ -1,8 +1,6 @@
 #ifndef PROPROOM3D_STDMATERIAL_H
 #define PROPROOM3D_STDMATERIAL_H
 
-#include <random>
-
 #include <CellarWorkbench/Misc/Distribution.h>
 
 #include "Material.h"
@@ -36,7 +34,7 @@ namespace prop3
 
     protected:
         // For exponential distribution
-        mutable std::mt19937 _randomEngine;
+        cellar::LinearRand _linearRand;
         cellar::SphereRand _sphereRand;
     };
 }
@@ -169,6 +169,19 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox Box::computeBoundingBox() const
+    {
+        // Negative scalings may have swapped corners
+        return AxisAlignedBox(
+            glm::min(_minCorner, _maxCorner),
+            glm::max(_minCorner, _maxCorner));
+    }
+
+    AxisAlignedBox Box::computeInteriorBoundingBox() const
+    {
+        return computeBoundingBox();
+    }
+
 
     // Box Texture
     BoxTexture::BoxTexture(
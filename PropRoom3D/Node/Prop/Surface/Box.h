@@ -36,6 +36,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         glm::dvec3 _center;
@@ -88,6 +88,15 @@ namespace prop3
         return false;
     }
 
+    std::shared_ptr<Surface> Disk::clone() const
+    {
+        Disk* copy = new Disk(_center, _normal, _radius);
+        copy->_transform = _transform;
+        copy->_invTransform = _invTransform;
+        copy->_transformN = _transformN;
+        return adoptCopy(copy);
+    }
+
     void Disk::transform(const Transform& transform)
     {
         _transform = transform.mat() * _transform;
@@ -96,4 +105,22 @@ namespace prop3
 
         stampCurrentUpdate();
     }
+
+    AxisAlignedBox Disk::computeBoundingBox() const
+    {
+        // A disk spans r*sin(theta) along an axis,
+        // where theta is the angle between the axis and the normal
+        glm::dvec3 n = glm::normalize(_normal);
+        glm::dvec3 extents = _radius * glm::sqrt(
+            glm::max(glm::dvec3(1.0) - n*n, glm::dvec3(0.0)));
+
+        AxisAlignedBox box(_center - extents, _center + extents);
+        return box.transformed(_transform);
+    }
+
+    AxisAlignedBox Disk::computeInteriorBoundingBox() const
+    {
+        // Every point is OUT of a disk
+        return AxisAlignedBox();
+    }
 }
@@ -34,6 +34,8 @@ namespace prop3
 
         double radius() const;
 
+        virtual std::shared_ptr<Surface> clone() const override;
+
 
         virtual bool isAffineTransformable() const override {return true;}
         virtual bool isTranslatable() const override {return true;}
@@ -42,6 +44,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
 
     private:
@@ -85,15 +85,66 @@ namespace prop3
         return glm::dot(ray.direction, _normal) != 0.0;
     }
 
+    std::shared_ptr<Surface> Plane::clone() const
+    {
+        return adoptCopy(new Plane(representation()));
+    }
+
     void Plane::transform(const Transform& transform)
     {
-        glm::dvec3 pt = glm::dvec3(transform.mat() * glm::dvec4((-_d) * _normal, 1.0));
-        _normal = glm::normalize(glm::dvec3(transform.mat() * glm::dvec4(_normal, 0.0)));
-        _d = -glm::dot(_normal, pt);
+        // Plane equations transform by the inverse transpose,
+        // which keeps them exact under non-uniform scalings
+        glm::dvec4 rep = glm::transpose(transform.inv()) * representation();
+        double length = glm::length(glm::dvec3(rep));
+        _normal = glm::dvec3(rep) / length;
+        _d = rep.w / length;
 
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox Plane::computeBoundingBox() const
+    {
+        AxisAlignedBox box = AxisAlignedBox::infinite();
+
+        // Only planes perpendicular to an axis are flat boxes
+        for(int k=0; k < 3; ++k)
+        {
+            if(_normal[k] != 0.0 &&
+               _normal[(k+1)%3] == 0.0 &&
+               _normal[(k+2)%3] == 0.0)
+            {
+                double pos = -_d / _normal[k];
+                box.minCorner[k] = pos;
+                box.maxCorner[k] = pos;
+            }
+        }
+
+        return box;
+    }
+
+    AxisAlignedBox Plane::computeInteriorBoundingBox() const
+    {
+        AxisAlignedBox box = AxisAlignedBox::infinite();
+
+        // Half-spaces are bounded on one side when
+        // the plane is perpendicular to an axis
+        for(int k=0; k < 3; ++k)
+        {
+            if(_normal[k] != 0.0 &&
+               _normal[(k+1)%3] == 0.0 &&
+               _normal[(k+2)%3] == 0.0)
+            {
+                double pos = -_d / _normal[k];
+                if(_normal[k] > 0.0)
+                    box.maxCorner[k] = pos;
+                else
+                    box.minCorner[k] = pos;
+            }
+        }
+
+        return box;
+    }
+
 
     // Textures
     PlaneTexture::PlaneTexture(const glm::dvec3& normal, const glm::dvec3& origin,
@@ -170,6 +221,12 @@ namespace prop3
         }
     }
 
+    std::shared_ptr<Surface> PlaneTexture::clone() const
+    {
+        return adoptCopy(new PlaneTexture(
+            representation(), _texU, _texV, _texOrigin));
+    }
+
     void PlaneTexture::transform(const Transform& transform)
     {
         _texOrigin = glm::dvec3(transform.mat() * glm::dvec4(_texOrigin, 1.0));
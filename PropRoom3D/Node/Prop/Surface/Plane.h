@@ -43,6 +43,8 @@ namespace prop3
 
         glm::dvec4 representation() const;
 
+        virtual std::shared_ptr<Surface> clone() const override;
+
         virtual bool isAffineTransformable() const override {return true;}
         virtual bool isTranslatable() const override {return true;}
         virtual bool isRotatable() const override {return true;}
@@ -50,6 +52,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         double _d;
@@ -94,6 +98,8 @@ namespace prop3
 
         glm::dvec3 texV() const;
 
+        virtual std::shared_ptr<Surface> clone() const override;
+
     protected:
         virtual void transform(const Transform& transform);
 
@@ -250,6 +250,11 @@ namespace prop3
         return false;
     }
 
+    std::shared_ptr<Surface> Quadric::clone() const
+    {
+        return adoptCopy(new Quadric(_q));
+    }
+
     void Quadric::transform(const Transform& transform)
     {
         _q = glm::transpose(transform.inv()) * _q * transform.inv();
@@ -257,6 +262,68 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox Quadric::computeBoundingBox() const
+    {
+        AxisAlignedBox box, interior;
+        ellipsoidBounds(box, interior);
+        return box;
+    }
+
+    AxisAlignedBox Quadric::computeInteriorBoundingBox() const
+    {
+        AxisAlignedBox box, interior;
+        ellipsoidBounds(box, interior);
+        return interior;
+    }
+
+    void Quadric::ellipsoidBounds(
+            AxisAlignedBox& box,
+            AxisAlignedBox& interior) const
+    {
+        box = AxisAlignedBox::infinite();
+        interior = AxisAlignedBox::infinite();
+
+        // Writing the quadric as x'Ax + 2b'x + c, only ellipsoids
+        // (definite A) are bounded : (x-x0)'A(x-x0) = k, x0 = -inv(A)b
+        glm::dmat3 A = glm::dmat3(_q);
+        A = (A + glm::transpose(A)) / 2.0;
+        glm::dvec3 b = (glm::dvec3(_q[3]) + glm::dvec3(
+            _q[0][3], _q[1][3], _q[2][3])) / 2.0;
+        double c = _q[3][3];
+
+        double d1 = A[0][0];
+        double d2 = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+        double d3 = glm::determinant(A);
+
+        bool isPositive = d1 > 0.0 && d2 > 0.0 && d3 > 0.0;
+        bool isNegative = d1 < 0.0 && d2 > 0.0 && d3 < 0.0;
+        if(!isPositive && !isNegative)
+            return;
+
+        glm::dmat3 invA = glm::inverse(A);
+        glm::dvec3 center = -(invA * b);
+        double k = glm::dot(b, invA * b) - c;
+
+        // Half extents are sqrt(k * inv(A)ii)
+        glm::dvec3 halfExt2 = k * glm::dvec3(invA[0][0], invA[1][1], invA[2][2]);
+        if(halfExt2.x < 0.0 || halfExt2.y < 0.0 || halfExt2.z < 0.0)
+        {
+            // Imaginary ellipsoid : the quadric never hits,
+            // points are either all OUT or all IN
+            box = AxisAlignedBox();
+            if(isPositive)
+                interior = AxisAlignedBox();
+            return;
+        }
+
+        glm::dvec3 halfExt = glm::sqrt(halfExt2);
+        box = AxisAlignedBox(center - halfExt, center + halfExt);
+
+        // Negative definite quadrics are IN outside of the ellipsoid
+        if(isPositive)
+            interior = box;
+    }
+
     void Quadric::params(
             const Raycast& ray,
             double& a,
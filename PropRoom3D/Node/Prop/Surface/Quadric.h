@@ -62,6 +62,8 @@ namespace prop3
 
         glm::dmat4 representation() const;
 
+        virtual std::shared_ptr<Surface> clone() const override;
+
         virtual bool isAffineTransformable() const override {return true;}
         virtual bool isTranslatable() const override {return true;}
         virtual bool isRotatable() const override {return true;}
@@ -69,9 +71,13 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
         void params(const Raycast& ray, double& a, double& b, double& c) const;
 
+        void ellipsoidBounds(AxisAlignedBox& box, AxisAlignedBox& interior) const;
+
     private:
         glm::dmat4 _q;
     };
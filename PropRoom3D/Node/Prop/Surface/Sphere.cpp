@@ -126,6 +126,17 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox Sphere::computeBoundingBox() const
+    {
+        glm::dvec3 extents(glm::abs(_radius));
+        return AxisAlignedBox(_center - extents, _center + extents);
+    }
+
+    AxisAlignedBox Sphere::computeInteriorBoundingBox() const
+    {
+        return computeBoundingBox();
+    }
+
     void Sphere::params(const Raycast& ray, double& a, double& b, double& c) const
     {
         glm::dvec3 dist = ray.origin - _center;
@@ -34,6 +34,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
         void params(const Raycast& ray, double& a, double& b, double& c) const;
 
@@ -40,7 +40,8 @@ namespace prop3
     const std::shared_ptr<Material> Surface::ENVIRONMENT_MATERIAL(material::AIR);
     const std::shared_ptr<Material> Surface::DEFAULT_MATERIAL(material::createInsulator(color::white, 1.40, 1.0, 1.0));
 
-    Surface::Surface()
+    Surface::Surface() :
+        _areBoundsValid(false)
     {
 
     }
@@ -88,6 +89,19 @@ namespace prop3
         return surf;
     }
 
+    std::shared_ptr<Surface> Surface::clone() const
+    {
+        return std::shared_ptr<Surface>();
+    }
+
+    void Surface::updateBounds() const
+    {
+        _boundingBox = computeBoundingBox();
+        _interiorBoundingBox = computeInteriorBoundingBox();
+        _boundsStamp = timeStamp();
+        _areBoundsValid = true;
+    }
+
 
     // Physical surfaces
     PhysicalSurface::PhysicalSurface() :
@@ -110,6 +124,14 @@ namespace prop3
         return { _coating, _innerMat, _outerMat };
     }
 
+    std::shared_ptr<Surface> PhysicalSurface::adoptCopy(PhysicalSurface* copy) const
+    {
+        copy->setCoating(_coating);
+        copy->setInnerMaterial(_innerMat);
+        copy->setOuterMaterial(_outerMat);
+        return std::shared_ptr<Surface>(copy);
+    }
+
     void PhysicalSurface::setCoating(const std::shared_ptr<Coating>& coating)
     {
         swapChild(_coating, coating);
@@ -183,6 +205,11 @@ namespace prop3
 
     void SurfaceShell::raycast(const Raycast& ray, RayHitList& reports) const
     {
+        // Don't bother transforming rays that can't reach the surface
+        const AxisAlignedBox& bounds = boundingBox();
+        if(bounds.isEmpty() || !bounds.intersects(ray))
+            return;
+
         Raycast tRay = ray;
         tRay.origin = glm::dvec3(_invTransform * glm::dvec4(ray.origin, 1.0));
         tRay.direction = glm::dvec3(_invTransform * glm::dvec4(ray.direction, 0.0));
@@ -211,6 +238,10 @@ namespace prop3
 
     bool SurfaceShell::intersects(const Raycast& ray, RayHitList& reports) const
     {
+        const AxisAlignedBox& bounds = boundingBox();
+        if(bounds.isEmpty() || !bounds.intersects(ray))
+            return false;
+
         Raycast tRay = ray;
         tRay.origin = glm::dvec3(_invTransform * glm::dvec4(ray.origin, 1.0));
         tRay.direction = glm::dvec3(_invTransform * glm::dvec4(ray.direction, 0.0));
@@ -228,6 +259,16 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox SurfaceShell::computeBoundingBox() const
+    {
+        return _surf->boundingBox().transformed(_mvTransform);
+    }
+
+    AxisAlignedBox SurfaceShell::computeInteriorBoundingBox() const
+    {
+        return _surf->interiorBoundingBox().transformed(_mvTransform);
+    }
+
 
     // SurfaceGhost
     SurfaceGhost::SurfaceGhost(const std::shared_ptr<Surface>& surf) :
@@ -311,6 +352,17 @@ namespace prop3
         applyTransformation(_surf, transform);
     }
 
+    AxisAlignedBox SurfaceGhost::computeBoundingBox() const
+    {
+        // Never generates intersection points
+        return AxisAlignedBox();
+    }
+
+    AxisAlignedBox SurfaceGhost::computeInteriorBoundingBox() const
+    {
+        return _surf->interiorBoundingBox();
+    }
+
 
     // SurfaceNot
     SurfaceInverse::SurfaceInverse(const std::shared_ptr<Surface>& surf) :
@@ -409,6 +461,17 @@ namespace prop3
         applyTransformation(_surf, transform);
     }
 
+    AxisAlignedBox SurfaceInverse::computeBoundingBox() const
+    {
+        return _surf->boundingBox();
+    }
+
+    AxisAlignedBox SurfaceInverse::computeInteriorBoundingBox() const
+    {
+        // The complement of a bounded region is never bounded
+        return AxisAlignedBox::infinite();
+    }
+
 
     // SurfaceOr
     SurfaceOr::SurfaceOr(const std::vector<std::shared_ptr<Surface>>& surfs) :
@@ -463,6 +526,10 @@ namespace prop3
     void SurfaceOr::raycast(const Raycast& ray,
                             RayHitList& reports) const
     {
+        const AxisAlignedBox& bounds = boundingBox();
+        if(bounds.isEmpty() || !bounds.intersects(ray))
+            return;
+
         size_t surfCount = _surfs.size();
         for(size_t i=0; i < surfCount; ++i)
         {
@@ -602,6 +669,22 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox SurfaceOr::computeBoundingBox() const
+    {
+        AxisAlignedBox box;
+        for(const auto& surf : _surfs)
+            box.extend(surf->boundingBox());
+        return box;
+    }
+
+    AxisAlignedBox SurfaceOr::computeInteriorBoundingBox() const
+    {
+        AxisAlignedBox box;
+        for(const auto& surf : _surfs)
+            box.extend(surf->interiorBoundingBox());
+        return box;
+    }
+
 
     // SurfaceAnd
     SurfaceAnd::SurfaceAnd(const std::vector<std::shared_ptr<Surface>>& surfs) :
@@ -656,6 +739,10 @@ namespace prop3
     void SurfaceAnd::raycast(const Raycast& ray,
                              RayHitList& reports) const
     {
+        const AxisAlignedBox& bounds = boundingBox();
+        if(bounds.isEmpty() || !bounds.intersects(ray))
+            return;
+
         size_t surfCount = _surfs.size();
         for(size_t i=0; i < surfCount; ++i)
         {
@@ -795,6 +882,43 @@ namespace prop3
         stampCurrentUpdate();
     }
 
+    AxisAlignedBox SurfaceAnd::computeBoundingBox() const
+    {
+        // A hit on one surface is only kept when it's not OUT of
+        // all the others. Prefix and suffix interior intersections
+        // give each surface the region covered by its siblings.
+        size_t surfCount = _surfs.size();
+        std::vector<AxisAlignedBox> suffix(surfCount + 1,
+            AxisAlignedBox::infinite());
+        for(size_t i=surfCount; i > 0; --i)
+        {
+            suffix[i-1] = suffix[i];
+            suffix[i-1].narrow(_surfs[i-1]->interiorBoundingBox());
+        }
+
+        AxisAlignedBox box;
+        AxisAlignedBox prefix = AxisAlignedBox::infinite();
+        for(size_t i=0; i < surfCount; ++i)
+        {
+            AxisAlignedBox hitBox = _surfs[i]->boundingBox();
+            hitBox.narrow(prefix);
+            hitBox.narrow(suffix[i+1]);
+            box.extend(hitBox);
+
+            prefix.narrow(_surfs[i]->interiorBoundingBox());
+        }
+
+        return box;
+    }
+
+    AxisAlignedBox SurfaceAnd::computeInteriorBoundingBox() const
+    {
+        AxisAlignedBox box = AxisAlignedBox::infinite();
+        for(const auto& surf : _surfs)
+            box.narrow(surf->interiorBoundingBox());
+        return box;
+    }
+
 
     // Operators
     std::shared_ptr<Surface> operator~ (
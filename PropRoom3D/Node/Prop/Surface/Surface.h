@@ -8,6 +8,7 @@
 #include <GLM/gtc/quaternion.hpp>
 
 #include <PropRoom3D/Node/Node.h>
+#include <PropRoom3D/Ray/AxisAlignedBox.h>
 
 
 namespace prop3
@@ -62,6 +63,13 @@ namespace prop3
         virtual void raycast(const Raycast& ray, RayHitList& reports) const = 0;
         virtual bool intersects(const Raycast& ray, RayHitList& reports) const = 0;
 
+        // Conservative bounds of the points where rays can hit the surface.
+        // Bounds are cached until the surface or one of its children changes.
+        const AxisAlignedBox& boundingBox() const;
+
+        // Conservative bounds of the points that are not OUT of the surface
+        const AxisAlignedBox& interiorBoundingBox() const;
+
         virtual void setCoating(const std::shared_ptr<Coating>& coating) = 0;
         virtual void setInnerMaterial(const std::shared_ptr<Material>& mat) = 0;
         virtual void setOuterMaterial(const std::shared_ptr<Material>& mat) = 0;
@@ -71,6 +79,10 @@ namespace prop3
         virtual bool isRotatable() const {return false;}
         virtual bool isScalable() const {return false;}
 
+        // Independent copy of a primitive, not registered to any parent.
+        // Returns nullptr for surfaces that can't be copied.
+        virtual std::shared_ptr<Surface> clone() const;
+
         // Transform tools
         static std::shared_ptr<Surface> shell(const std::shared_ptr<Surface>& surf);
         static std::shared_ptr<Surface> transform(std::shared_ptr<Surface>& surf, const glm::dmat4& mat);
@@ -86,6 +98,17 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) = 0;
+
+        virtual AxisAlignedBox computeBoundingBox() const = 0;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const = 0;
+
+    private:
+        void updateBounds() const;
+
+        mutable bool _areBoundsValid;
+        mutable TimeStamp _boundsStamp;
+        mutable AxisAlignedBox _boundingBox;
+        mutable AxisAlignedBox _interiorBoundingBox;
     };
 
 
@@ -109,6 +132,8 @@ namespace prop3
         std::shared_ptr<Material> outerMaterial() const;
 
     protected:
+        std::shared_ptr<Surface> adoptCopy(PhysicalSurface* copy) const;
+
         std::shared_ptr<Coating>  _coating;
         std::shared_ptr<Material> _innerMat;
         std::shared_ptr<Material> _outerMat;
@@ -146,6 +171,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         std::shared_ptr<Surface> _surf;
@@ -186,6 +213,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         std::shared_ptr<Surface> _surf;
@@ -222,6 +251,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         std::shared_ptr<Surface> _surf;
@@ -261,6 +292,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         void add(const std::shared_ptr<Surface>& surface);
@@ -302,6 +335,8 @@ namespace prop3
 
     protected:
         virtual void transform(const Transform& transform) override;
+        virtual AxisAlignedBox computeBoundingBox() const override;
+        virtual AxisAlignedBox computeInteriorBoundingBox() const override;
 
     private:
         void add(const std::shared_ptr<Surface>& surface);
@@ -344,6 +379,22 @@ namespace prop3
         return signedDistance(glm::dvec3(x, y, z));
     }
 
+    inline const AxisAlignedBox& Surface::boundingBox() const
+    {
+        if(!_areBoundsValid || _boundsStamp < timeStamp())
+            updateBounds();
+
+        return _boundingBox;
+    }
+
+    inline const AxisAlignedBox& Surface::interiorBoundingBox() const
+    {
+        if(!_areBoundsValid || _boundsStamp < timeStamp())
+            updateBounds();
+
+        return _interiorBoundingBox;
+    }
+
     inline std::shared_ptr<Coating> PhysicalSurface::coating() const
     {
         return _coating;
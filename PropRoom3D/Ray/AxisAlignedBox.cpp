@@ -0,0 +1,66 @@
+#include "AxisAlignedBox.h"
+
+
+namespace prop3
+{
+    AxisAlignedBox::AxisAlignedBox() :
+        minCorner(INFINITY),
+        maxCorner(-INFINITY)
+    {
+    }
+
+    AxisAlignedBox::AxisAlignedBox(
+            const glm::dvec3& minCorner,
+            const glm::dvec3& maxCorner) :
+        minCorner(minCorner),
+        maxCorner(maxCorner)
+    {
+    }
+
+    AxisAlignedBox AxisAlignedBox::infinite()
+    {
+        return AxisAlignedBox(glm::dvec3(-INFINITY), glm::dvec3(INFINITY));
+    }
+
+    bool AxisAlignedBox::isInfinite() const
+    {
+        return glm::any(glm::isinf(minCorner)) ||
+               glm::any(glm::isinf(maxCorner));
+    }
+
+    double AxisAlignedBox::surfaceArea() const
+    {
+        if(isEmpty())
+            return 0.0;
+
+        glm::dvec3 d = dimensions();
+        return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    AxisAlignedBox AxisAlignedBox::transformed(const glm::dmat4& mat) const
+    {
+        if(isEmpty())
+            return AxisAlignedBox();
+
+        // Accumulate each axis' contribution separately so that
+        // infinite extents only spread along non-null matrix terms
+        glm::dvec3 translation(mat[3]);
+        AxisAlignedBox box(translation, translation);
+        for(int i=0; i < 3; ++i)
+        {
+            for(int j=0; j < 3; ++j)
+            {
+                double m = mat[j][i];
+                if(m != 0.0)
+                {
+                    double a = m * minCorner[j];
+                    double b = m * maxCorner[j];
+                    box.minCorner[i] += glm::min(a, b);
+                    box.maxCorner[i] += glm::max(a, b);
+                }
+            }
+        }
+
+        return box;
+    }
+}
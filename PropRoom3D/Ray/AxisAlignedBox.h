@@ -0,0 +1,106 @@
+#ifndef PROPROOM3D_AXISALIGNEDBOX_H
+#define PROPROOM3D_AXISALIGNEDBOX_H
+
+#include <GLM/glm.hpp>
+
+#include "Raycast.h"
+
+
+namespace prop3
+{
+    class PROP3D_EXPORT AxisAlignedBox
+    {
+    public:
+        // Empty box (contains nothing)
+        AxisAlignedBox();
+
+        AxisAlignedBox(const glm::dvec3& minCorner,
+                       const glm::dvec3& maxCorner);
+
+        static AxisAlignedBox infinite();
+
+        bool isEmpty() const;
+        bool isInfinite() const;
+
+        glm::dvec3 center() const;
+        glm::dvec3 dimensions() const;
+        double surfaceArea() const;
+        bool contains(const glm::dvec3& point) const;
+
+        void extend(const glm::dvec3& point);
+        void extend(const AxisAlignedBox& box); // Ignores empty boxes
+        void narrow(const AxisAlignedBox& box);
+
+        AxisAlignedBox transformed(const glm::dmat4& mat) const;
+
+        // Slab test limited to [0, ray.limit]
+        bool intersects(const Raycast& ray) const;
+
+        glm::dvec3 minCorner;
+        glm::dvec3 maxCorner;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline bool AxisAlignedBox::isEmpty() const
+    {
+        return minCorner.x > maxCorner.x ||
+               minCorner.y > maxCorner.y ||
+               minCorner.z > maxCorner.z;
+    }
+
+    inline glm::dvec3 AxisAlignedBox::center() const
+    {
+        return (minCorner + maxCorner) / 2.0;
+    }
+
+    inline glm::dvec3 AxisAlignedBox::dimensions() const
+    {
+        return maxCorner - minCorner;
+    }
+
+    inline bool AxisAlignedBox::contains(const glm::dvec3& point) const
+    {
+        return minCorner.x <= point.x && point.x <= maxCorner.x &&
+               minCorner.y <= point.y && point.y <= maxCorner.y &&
+               minCorner.z <= point.z && point.z <= maxCorner.z;
+    }
+
+    inline void AxisAlignedBox::extend(const glm::dvec3& point)
+    {
+        minCorner = glm::min(minCorner, point);
+        maxCorner = glm::max(maxCorner, point);
+    }
+
+    inline void AxisAlignedBox::extend(const AxisAlignedBox& box)
+    {
+        if(!box.isEmpty())
+        {
+            minCorner = glm::min(minCorner, box.minCorner);
+            maxCorner = glm::max(maxCorner, box.maxCorner);
+        }
+    }
+
+    inline void AxisAlignedBox::narrow(const AxisAlignedBox& box)
+    {
+        minCorner = glm::max(minCorner, box.minCorner);
+        maxCorner = glm::min(maxCorner, box.maxCorner);
+    }
+
+    inline bool AxisAlignedBox::intersects(const Raycast& ray) const
+    {
+        glm::dvec3 t1 = (minCorner - ray.origin) * ray.invDir;
+        glm::dvec3 t2 = (maxCorner - ray.origin) * ray.invDir;
+
+        glm::dvec3 vtmin = glm::min(t1, t2);
+        glm::dvec3 vtmax = glm::max(t1, t2);
+
+        double tmin = glm::max(glm::max(vtmin.x, vtmin.y), vtmin.z);
+        double tmax = glm::min(glm::min(vtmax.x, vtmax.y), vtmax.z);
+
+        return tmax >= glm::max(tmin, 0.0) && tmin < ray.limit;
+    }
+}
+
+#endif // PROPROOM3D_AXISALIGNEDBOX_H
@@ -4,7 +4,8 @@
 namespace prop3
 {
     RayHitList::RayHitList() :
-        head(nullptr)
+        head(nullptr),
+        _memoryPool(nullptr)
     {
     }
 
@@ -16,11 +17,22 @@ namespace prop3
 
     void RayHitList::releaseMemoryPool()
     {
-        size_t count = _memoryPool.size();
-        for(size_t i=0; i < count; ++i)
-            delete _memoryPool[i];
+        for(RayHitReport* list : _clearedLists)
+        {
+            while(list != nullptr)
+            {
+                RayHitReport* next = list->_next;
+                delete list;
+                list = next;
+            }
+        }
+        _clearedLists.clear();
 
-        _memoryPool.clear();
-        _memoryPool.shrink_to_fit();
+        while(_memoryPool != nullptr)
+        {
+            RayHitReport* next = _memoryPool->_next;
+            delete _memoryPool;
+            _memoryPool = next;
+        }
     }
 }
@@ -8,6 +8,10 @@
 
 namespace prop3
 {
+    // Reports are recycled through a free list threaded by their
+    // _next pointer, so that clearing or disposing never allocates.
+    // Cleared lists are kept whole until the free list runs out,
+    // which spares clear() from walking them.
     class RayHitList
     {
     public:
@@ -32,7 +36,8 @@ namespace prop3
         RayHitReport* head;
 
     private:
-        std::vector<RayHitReport*> _memoryPool;
+        RayHitReport* _memoryPool;
+        std::vector<RayHitReport*> _clearedLists;
     };
 
 
@@ -47,8 +52,14 @@ namespace prop3
             const Material* innerMat,
             const Material* outerMat)
     {
+        if(_memoryPool == nullptr && !_clearedLists.empty())
+        {
+            _memoryPool = _clearedLists.back();
+            _clearedLists.pop_back();
+        }
+
         RayHitReport* report;
-        if(_memoryPool.empty())
+        if(_memoryPool == nullptr)
         {
             report = new RayHitReport(
                         length,
@@ -61,7 +72,8 @@ namespace prop3
         }
         else
         {
-            report = _memoryPool.back();
+            report = _memoryPool;
+            _memoryPool = report->_next;
 
             report->length = length;
             report->position = position;
@@ -70,8 +82,6 @@ namespace prop3
             report->coating = coating;
             report->innerMat = innerMat;
             report->outerMat = outerMat;
-
-            _memoryPool.pop_back();
         }
 
         add(report);
@@ -85,18 +95,17 @@ namespace prop3
 
     inline void RayHitList::clear()
     {
-        RayHitReport* report = head;
-        while(report != nullptr)
-        {
-            _memoryPool.push_back(report);
-            report = report->_next;
-        }
+        if(head == nullptr)
+            return;
+
+        _clearedLists.push_back(head);
         head = nullptr;
     }
 
     inline void RayHitList::dispose(RayHitReport* node)
     {
-        _memoryPool.push_back(node);
+        node->_next = _memoryPool;
+        _memoryPool = node;
     }
 }
 
@@ -45,7 +45,13 @@ namespace prop3
                 currMaterial = outerMat;
             }
 
-            glm::dvec3 espilonDist = normal * EPSILON_LENGTH;
+            // Positions carry an error relative to their magnitude,
+            // so far away hits need proportionally larger offsets
+            glm::dvec3 magnitude = glm::abs(position);
+            double scale = glm::max(1.0, glm::max(
+                glm::max(magnitude.x, magnitude.y), magnitude.z));
+
+            glm::dvec3 espilonDist = normal * (EPSILON_LENGTH * scale);
             reflectionOrigin = position +  espilonDist;
             refractionOrigin = position -  espilonDist;
         }
@@ -0,0 +1,80 @@
+#include "RayPacket.h"
+
+#include "AxisAlignedBox.h"
+
+
+namespace prop3
+{
+    RayPacket::RayPacket()
+    {
+        _rays.reserve(LANE_COUNT);
+        clear();
+    }
+
+    void RayPacket::clear()
+    {
+        _rays.clear();
+
+        // Unused lanes never hit anything
+        for(int l=0; l < LANE_COUNT; ++l)
+        {
+            _originX[l] = _originY[l] = _originZ[l] = 0.0;
+            _invDirX[l] = _invDirY[l] = _invDirZ[l] = 1.0;
+            _limit[l] = -1.0;
+        }
+    }
+
+    void RayPacket::add(const Raycast& ray)
+    {
+        int lane = int(_rays.size());
+        _rays.push_back(ray);
+
+        _originX[lane] = ray.origin.x;
+        _originY[lane] = ray.origin.y;
+        _originZ[lane] = ray.origin.z;
+        _invDirX[lane] = ray.invDir.x;
+        _invDirY[lane] = ray.invDir.y;
+        _invDirZ[lane] = ray.invDir.z;
+        _limit[lane] = ray.limit;
+    }
+
+    RayPacket::LaneMask RayPacket::intersects(const AxisAlignedBox& box) const
+    {
+        double tmin[LANE_COUNT];
+        double tmax[LANE_COUNT];
+
+        // Axis per axis, every lane at once
+        for(int l=0; l < LANE_COUNT; ++l)
+        {
+            double t1 = (box.minCorner.x - _originX[l]) * _invDirX[l];
+            double t2 = (box.maxCorner.x - _originX[l]) * _invDirX[l];
+            tmin[l] = glm::min(t1, t2);
+            tmax[l] = glm::max(t1, t2);
+        }
+
+        for(int l=0; l < LANE_COUNT; ++l)
+        {
+            double t1 = (box.minCorner.y - _originY[l]) * _invDirY[l];
+            double t2 = (box.maxCorner.y - _originY[l]) * _invDirY[l];
+            tmin[l] = glm::max(tmin[l], glm::min(t1, t2));
+            tmax[l] = glm::min(tmax[l], glm::max(t1, t2));
+        }
+
+        for(int l=0; l < LANE_COUNT; ++l)
+        {
+            double t1 = (box.minCorner.z - _originZ[l]) * _invDirZ[l];
+            double t2 = (box.maxCorner.z - _originZ[l]) * _invDirZ[l];
+            tmin[l] = glm::max(tmin[l], glm::min(t1, t2));
+            tmax[l] = glm::min(tmax[l], glm::max(t1, t2));
+        }
+
+        LaneMask mask = 0;
+        for(int l=0; l < LANE_COUNT; ++l)
+        {
+            if(tmax[l] >= glm::max(tmin[l], 0.0) && tmin[l] < _limit[l])
+                mask |= (1u << l);
+        }
+
+        return mask & lanes();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef PROPROOM3D_RAYPACKET_H
+#define PROPROOM3D_RAYPACKET_H
+
+#include <vector>
+
+#include "Raycast.h"
+
+
+namespace prop3
+{
+    class AxisAlignedBox;
+
+
+    // Coherent rays traversing the search structure together.
+    // Box tests are shared by the whole packet and laid out as
+    // structures of arrays so that lanes are processed in SIMD.
+    class PROP3D_EXPORT RayPacket
+    {
+    public:
+        static const int LANE_COUNT = 4;
+
+        typedef unsigned int LaneMask;
+
+        RayPacket();
+
+        void clear();
+        void add(const Raycast& ray);
+
+        int size() const;
+        bool isFull() const;
+        LaneMask lanes() const;
+
+        const Raycast& ray(int lane) const;
+        void setLimit(int lane, double limit);
+
+        // Slab test of every lane limited to [0, ray.limit]
+        LaneMask intersects(const AxisAlignedBox& box) const;
+
+    private:
+        std::vector<Raycast> _rays;
+
+        double _originX[LANE_COUNT];
+        double _originY[LANE_COUNT];
+        double _originZ[LANE_COUNT];
+        double _invDirX[LANE_COUNT];
+        double _invDirY[LANE_COUNT];
+        double _invDirZ[LANE_COUNT];
+        double _limit[LANE_COUNT];
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline int RayPacket::size() const
+    {
+        return int(_rays.size());
+    }
+
+    inline bool RayPacket::isFull() const
+    {
+        return _rays.size() == LANE_COUNT;
+    }
+
+    inline RayPacket::LaneMask RayPacket::lanes() const
+    {
+        return (1u << _rays.size()) - 1u;
+    }
+
+    inline const Raycast& RayPacket::ray(int lane) const
+    {
+        return _rays[lane];
+    }
+
+    inline void RayPacket::setLimit(int lane, double limit)
+    {
+        _rays[lane].limit = limit;
+        _limit[lane] = limit;
+    }
+}
+
+#endif // PROPROOM3D_RAYPACKET_H
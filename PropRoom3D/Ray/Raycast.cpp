@@ -1,5 +1,7 @@
 #include "Raycast.h"
 
+#include <cmath>
+
 
 namespace prop3
 {
@@ -20,7 +22,8 @@ namespace prop3
         sample(sample),
         origin(origin),
         direction(direction),
-        invDir(1.0 / direction)
+        invDir(1.0 / direction),
+        density(0.0)
     {}
 
     double Raycast::getEntropy(double roughness)
@@ -53,4 +56,19 @@ namespace prop3
         double bindingDist = lightRay.limit * (1.0 - specularity);
         return eyeRay.virtDist + bindingDist + endDist;
     }
+
+    double Raycast::powerHeuristic(double density, double otherDensity)
+    {
+        if(density <= 0.0 || otherDensity <= 0.0)
+            return 1.0;
+
+        // Infinite densities belong to singular strategies
+        if(std::isinf(density))
+            return 1.0;
+        if(std::isinf(otherDensity))
+            return 0.0;
+
+        double ratio = otherDensity / density;
+        return 1.0 / (1.0 + ratio * ratio);
+    }
 }
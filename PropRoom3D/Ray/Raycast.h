@@ -30,6 +30,12 @@ namespace prop3
                 const Raycast& lightRay,
                 double roughness);
 
+        // Multiple importance sampling weight of a sample drawn
+        // at density, when another strategy could have drawn it
+        // at otherDensity. Densities of zero stand for strategies
+        // that don't compete.
+        static double powerHeuristic(double density, double otherDensity);
+
         double limit;
         double entropy;
         double virtDist;
@@ -39,6 +45,10 @@ namespace prop3
         glm::dvec3 direction;
         glm::dvec3 invDir;
 
+        // Solid angle density of the coating lobe that sampled the
+        // ray's direction. Zero when it wasn't sampled by a lobe.
+        double density;
+
         static const double FULLY_DIFFUSE;
         static const double FULLY_SPECULAR;
         static const double BACKDROP_LIMIT;
@@ -321,6 +321,7 @@ namespace prop3
             float renderTime = raytracerState()->renderTime();
             float secPerFrame = renderTime / sampleCount;
             float divergence = raytracerState()->divergence();
+            float prioTime = raytracerState()->prioritizationTime();
 
             ss << "\t(";
             ss.precision(3);
@@ -331,6 +332,9 @@ namespace prop3
             ss << ", ";
             ss.precision(3);
             ss << std::scientific << std::setw(10) << divergence << " div";
+            ss << ", ";
+            ss.precision(3);
+            ss << std::fixed << std::setw(10) << prioTime * 1000.0 << " ms prio";
             ss << ")";
             //*/
 
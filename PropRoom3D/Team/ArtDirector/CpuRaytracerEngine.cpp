@@ -11,6 +11,7 @@
 #include "Film/StaticFilm.h"
 #include "Film/ConvergentFilm.h"
 #include "CpuRaytracerWorker.h"
+#include "CpuWavefrontWorker.h"
 #include "RaytracerState.h"
 #include "SearchStructure.h"
 
@@ -34,8 +35,6 @@ namespace prop3
         {
             _protectedState.setWorkerCount( DEFAULT_WORKER_COUNT );
         }
-
-        cellar::g_masterRandomArray.allocate();
     }
 
     CpuRaytracerEngine::CpuRaytracerEngine(unsigned int  workerCount) :
@@ -46,8 +45,6 @@ namespace prop3
         _stageSetUpdated(false)
     {
         _protectedState.setWorkerCount( workerCount );
-
-        cellar::g_masterRandomArray.allocate();
     }
 
     CpuRaytracerEngine::~CpuRaytracerEngine()
@@ -61,8 +58,6 @@ namespace prop3
         {
             t.join();
         }
-
-        cellar::g_masterRandomArray.deallocate();
     }
 
     void CpuRaytracerEngine::setup(
@@ -71,6 +66,7 @@ namespace prop3
     {
         _protectedState.setDraftParams(draftParams);
 
+        placeWorkers();
         setupFilms(mainFilm);
         setupWorkers();
     }
@@ -139,6 +135,8 @@ namespace prop3
                 _protectedState.startTimeChrono();
             }
 
+            setupWorkerModes();
+
             _protectedState.setInterrupted( false );
             for(auto& w : _workerObjects)
             {
@@ -162,6 +160,8 @@ namespace prop3
         _protectedState.incSampleCount();
         _protectedState.setDivergence(
             _currentFilm->compileDivergence());
+        _protectedState.setPrioritizationTime(
+            _currentFilm->prioritizationTime());
 
         if(_raytracerState->isDrafting())
         {
@@ -298,10 +298,44 @@ namespace prop3
 
         _searchStructure.reset(new SearchStructure(stageSet));
         _protectedState.setHiddenSurfaceRemoved(false);
+        _protectedState.setVisibilityHistogram(std::vector<unsigned int>());
 
-        for(auto& w : _workerObjects)
+        distributeSearchStructure();
+    }
+
+    void CpuRaytracerEngine::distributeSearchStructure()
+    {
+        size_t nodeCount = std::max(_cpuTopology.nodeCount(), 1u);
+        _nodeSearchStructures.assign(nodeCount, _searchStructure);
+
+        // Replicas are built by a thread of their node, so that the
+        // node's workers traverse memory local to them
+        if(nodeCount > 1 && !_searchStructure->isEmpty())
         {
-            w->updateSearchStructure(_searchStructure);
+            std::vector<std::thread> replicators;
+            for(size_t n=0; n < nodeCount; ++n)
+            {
+                auto cpu = std::find_if(_workerCpus.begin(), _workerCpus.end(),
+                    [n](const cellar::LogicalCpu& c){ return c.nodeId == n; });
+                if(cpu == _workerCpus.end())
+                    continue;
+
+                unsigned int cpuId = cpu->cpuId;
+                replicators.push_back(std::thread([this, n, cpuId](){
+                    cellar::CpuTopology::pinCurrentThread(cpuId);
+                    _nodeSearchStructures[n] = _searchStructure->replicate();
+                }));
+            }
+
+            for(std::thread& t : replicators)
+                t.join();
+        }
+
+        for(size_t w=0; w < _workerObjects.size(); ++w)
+        {
+            size_t node = w < _workerNodes.size() ? _workerNodes[w] : 0;
+            _workerObjects[w]->updateSearchStructure(
+                _nodeSearchStructures[node % nodeCount]);
         }
     }
 
@@ -339,6 +373,9 @@ namespace prop3
         // Main film: full resolution shot
         _films.push_back(mainFilm);
 
+        for(auto& film : _films)
+            film->setWorkerNodes(_workerNodes);
+
         _currentFilm = _films.front();
 
 
@@ -364,6 +401,11 @@ namespace prop3
         int surfVisToPixCount = _raytracerState->surfaceVisibilityThreshold()
                 * (_currentFilm->frameWidth() * _currentFilm->frameHeight());
 
+        std::vector<unsigned int> visibilityBins;
+        _searchStructure->reduceHitCounters();
+        _searchStructure->visibilityHistogram(visibilityBins);
+        _protectedState.setVisibilityHistogram(visibilityBins);
+
         _searchStructure->removeHiddenSurfaces(
                 surfVisToPixCount,
                 removedZones,
@@ -371,6 +413,10 @@ namespace prop3
 
         _protectedState.setHiddenSurfaceRemoved(true);
 
+        // Replicas don't follow the removal
+        if(_nodeSearchStructures.size() > 1)
+            distributeSearchStructure();
+
         cellar::getLog().postMessage(new cellar::Message('I', false,
             "Hidden surface removed : "
             + std::to_string(removedZones) + "z, "
@@ -430,6 +476,29 @@ namespace prop3
         }
     }
 
+    void CpuRaytracerEngine::placeWorkers()
+    {
+        _cpuTopology.detect();
+
+        size_t workerCount = _raytracerState->workerCount();
+        _workerCpus = _cpuTopology.placeThreads(workerCount);
+
+        _workerNodes.clear();
+        std::string cpuList;
+        for(const cellar::LogicalCpu& cpu : _workerCpus)
+        {
+            _workerNodes.push_back(cpu.nodeId);
+            cpuList += (cpuList.empty() ? "" : ",") + std::to_string(cpu.cpuId);
+        }
+
+        std::string report = _cpuTopology.report() +
+            "\nWorkers placed on CPUs " + cpuList;
+        _protectedState.setTopologyReport(report);
+
+        cellar::getLog().postMessage(new cellar::Message('I', false,
+            report, "CpuRaytracerEngine"));
+    }
+
     void CpuRaytracerEngine::setupWorkers()
     {
         if(!_workerThreads.empty())
@@ -439,19 +508,28 @@ namespace prop3
                 "CpuRaytracerEngine"));
 
             terminate();
+            _workerObjects.clear();
         }
 
 
         size_t workerCount = _raytracerState->workerCount();
+        bool wavefront = _raytracerState->pipeline() ==
+                            RaytracerState::PIPELINE_WAVEFRONT;
 
         cellar::getLog().postMessage(new cellar::Message('I', false,
-            "Using " + std::to_string(workerCount) + " raytracer workers to render stageSet",
+            "Using " + std::to_string(workerCount) +
+            (wavefront ? " wavefront" : "") +
+            " raytracer workers to render stageSet",
             "CpuRaytracerEngine"));
 
+        bool pinned = true;
         for(size_t i=0; i < workerCount; ++i)
         {
-            std::shared_ptr<CpuRaytracerWorker> worker(
-                new CpuRaytracerWorker());
+            std::shared_ptr<CpuRaytracerWorker> worker;
+            if(wavefront)
+                worker.reset(new CpuWavefrontWorker(i));
+            else
+                worker.reset(new CpuRaytracerWorker(i));
 
             worker->updateFilm(_currentFilm);
 
@@ -460,6 +538,41 @@ namespace prop3
                 std::move(std::thread(
                     CpuRaytracerWorker::launchWorker,
                     _workerObjects[i])));
+
+            if(i < _workerCpus.size())
+            {
+                pinned = cellar::CpuTopology::pinThread(
+                    _workerThreads.back(), _workerCpus[i].cpuId) && pinned;
+            }
+        }
+
+        if(!pinned)
+        {
+            cellar::getLog().postMessage(new cellar::Message('W', false,
+                "Raytracer workers could not be pinned to their CPUs",
+                "CpuRaytracerEngine"));
+        }
+
+        setupWorkerModes();
+    }
+
+    void CpuRaytracerEngine::setupWorkerModes()
+    {
+        std::string bounceMode = _raytracerState->bounceMode();
+
+        cellar::RandomStream::Sequence sequence =
+            cellar::RandomStream::Sequence::WHITE_NOISE;
+        std::string sequenceName = _raytracerState->sampleSequence();
+        if(sequenceName == RaytracerState::SEQUENCE_SOBOL)
+            sequence = cellar::RandomStream::Sequence::SOBOL;
+        else if(sequenceName == RaytracerState::SEQUENCE_RANK1_LATTICE)
+            sequence = cellar::RandomStream::Sequence::RANK1_LATTICE;
+
+        for(auto& w : _workerObjects)
+        {
+            w->useSampleSequence(sequence);
+            w->useSinglePathBounces(
+                bounceMode == RaytracerState::BOUNCE_SINGLE_PATH);
         }
     }
 
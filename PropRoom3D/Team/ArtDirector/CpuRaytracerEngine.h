@@ -7,6 +7,8 @@
 
 #include <GLM/glm.hpp>
 
+#include <CellarWorkbench/Misc/CpuTopology.h>
+
 #include "RaytracerState.h"
 
 #include <PropRoom3D/Node/Node.h>
@@ -57,10 +59,16 @@ namespace prop3
         virtual void dispatchStageSet(const std::string& stageSet);
         virtual void setupFilms(const std::shared_ptr<Film>& mainFilm);
         virtual void optimizeSearchStructure();
+
+        // Hands workers the search structure, replicated on
+        // each NUMA node that runs workers
+        virtual void distributeSearchStructure();
         virtual void abortRendering();
         virtual void skipDrafting();
         virtual void nextDraftSize();
+        virtual void placeWorkers();
         virtual void setupWorkers();
+        virtual void setupWorkerModes();
         virtual void softReset();
 
         virtual void performNonStochasticSyncronousDraf();
@@ -81,9 +89,14 @@ namespace prop3
         std::vector<std::thread> _workerThreads;
         std::vector<std::shared_ptr<CpuRaytracerWorker>> _workerObjects;
 
+        cellar::CpuTopology _cpuTopology;
+        std::vector<cellar::LogicalCpu> _workerCpus;
+        std::vector<size_t> _workerNodes;
+
         bool _stageSetUpdated;
         std::string _stageSetStream;
         std::shared_ptr<SearchStructure> _searchStructure;
+        std::vector<std::shared_ptr<SearchStructure>> _nodeSearchStructures;
     };
 }
 
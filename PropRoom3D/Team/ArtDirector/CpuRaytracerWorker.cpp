@@ -6,6 +6,7 @@
 #include "Node/Prop/Prop.h"
 #include "Node/Prop/Surface/Surface.h"
 #include "Node/Prop/Coating/Coating.h"
+#include "Node/Prop/Coating/EmissiveCoating.h"
 #include "Node/Prop/Material/Material.h"
 
 #include "Ray/Raycast.h"
@@ -35,19 +36,24 @@ namespace prop3
         worker->execute();
     }
 
-    CpuRaytracerWorker::CpuRaytracerWorker() :
+    CpuRaytracerWorker::CpuRaytracerWorker(size_t workerId) :
+        _workerId(workerId),
         _runningPredicate(false),
         _terminatePredicate(false),
         _incomingTileOnly(false),
         _useStochasticTracing(true),
         _usePixelJittering(true),
         _useDepthOfField(true),
+        _useSinglePathBounces(false),
+        _sampleSequence(cellar::RandomStream::Sequence::SOBOL),
         _lightDirectRayCount(1),
+        _lightSampleCount(4),
         _screenRayIntensityThreshold(1.0 / 16.0),
         _maxScreenBounceCount(24),
         _sufficientScreenRayBounce(4),
         _sufficientScreenRayWeight(0.50),
         _minScreenRayWeight(0.04),
+        _rouletteStartBounce(3),
         _aperture(0.0),
         _confusionRadius(0.1)
     {
@@ -141,6 +147,8 @@ namespace prop3
             _backdrop = _stageSet->backdrop();
             _ambMaterial = _stageSet->ambientMaterial();
             _searchStructure = searchStructure;
+            _hitCounters = searchStructure->createHitCounters();
+            _lightOccluders.clear();
         });
     }
 
@@ -159,6 +167,17 @@ namespace prop3
         _useDepthOfField = use;
     }
 
+    void CpuRaytracerWorker::useSinglePathBounces(bool use)
+    {
+        _useSinglePathBounces = use;
+    }
+
+    void CpuRaytracerWorker::useSampleSequence(
+            cellar::RandomStream::Sequence sequence)
+    {
+        _sampleSequence = sequence;
+    }
+
     void CpuRaytracerWorker::skipAndExecute(const std::function<void()>& func)
     {
         // Skip current frame
@@ -231,16 +250,41 @@ namespace prop3
                     }
                 }
 
+                // Help the film with work it handed to workers
+                while(_runningPredicate &&
+                      _workingFilm->runPendingTask())
+                    continue;
+
                 // Generate a single new tile
                 if(_runningPredicate)
                 {
                     std::shared_ptr<Tile> tile;
-                    tile = _workingFilm->nextTile();
+                    tile = _workingFilm->nextTile(_workerId);
                     if(tile != _workingFilm->endTile())
                     {
-                        tile->lock();
-                        shootFromScreen(tile);
-                        tile->unlock();
+                        // Other workers may claim sub-tiles meanwhile.
+                        // Samples are kept in the worker's scratch tile
+                        // and only lock the sub-tile while merged.
+                        std::shared_ptr<Tile> subTile;
+                        while(_runningPredicate &&
+                              (subTile = tile->claimSubTile()).get() != nullptr)
+                        {
+                            subTile->lock();
+                            _workingFilm->prepareScratchTile(_scratchTile, *subTile);
+                            subTile->unlock();
+
+                            shootFromScreen(subTile);
+
+                            subTile->lock();
+                            _workingFilm->mergeScratchTile(_scratchTile);
+                            subTile->unlock();
+
+                            if(tile->subTileCompleted())
+                            {
+                                _workingFilm->tileCompleted(*tile);
+                                tile->startQueuedPass();
+                            }
+                        }
                     }
                     else
                     {
@@ -257,11 +301,11 @@ namespace prop3
         double pixelHeight = 2.0 / _workingFilm->frameHeight();
         glm::dvec2 pixelSize(pixelWidth, pixelHeight);
         glm::dvec2 frameOrig = -glm::dvec2(_workingFilm->frameResolution()) / 2.0;
+        int frameWidth = _workingFilm->frameWidth();
 
-        if(_usePixelJittering)
-        {
-            frameOrig += _linearRand.gen2() - glm::dvec2(0.5);
-        }
+        // Samples are keyed by pixel and by their index in the pixel
+        cellar::RandomStream& random = cellar::RandomStream::local();
+        random.setSequence(_sampleSequence);
 
         Raycast raycast(
             Raycast::FULLY_SPECULAR,
@@ -269,53 +313,117 @@ namespace prop3
             _camPos,
             glm::dvec3(0.0));
 
-        for(TileIterator it = tile->begin();
-            it != tile->end() && _runningPredicate;
-            ++it)
+        const Coating* nullCoat = nullptr;
+        const Material* nullMat = nullptr;
+        const glm::dvec3 nullVec3 = glm::dvec3();
+        const RayHitReport nullReport(Raycast::BACKDROP_LIMIT,
+                nullVec3, nullVec3, nullVec3, nullCoat, nullMat, nullMat);
+
+        TileIterator it = tile->begin();
+        while(it != tile->end() && _runningPredicate)
         {
-            int pixelCycleCount = 0;
-            int maxCycleCount = (_useStochasticTracing ? 16 : 1);
+            // Neighbor pixels form a packet of coherent primary rays
+            _packetPixels.clear();
+            while(it != tile->end() &&
+                  _packetPixels.size() < RayPacket::LANE_COUNT)
+            {
+                _packetPixels.push_back(it);
+                ++it;
+            }
 
-            double expextedWeightSum = it.sampleWeight();
-            double multipliedWeightSum = expextedWeightSum *
-                                         it.sampleMultiplicity();
+            int pixelCount = int(_packetPixels.size());
+            unsigned int sampleCounts[RayPacket::LANE_COUNT];
+            uint32_t firstSamples[RayPacket::LANE_COUNT];
+            unsigned int maxCycleCount = 0;
+            int pixelLanes[RayPacket::LANE_COUNT];
+            uint32_t laneSamples[RayPacket::LANE_COUNT];
 
-            double totalWeightSum = 0.0;
+            // Films allocate each pixel's samples for the pass
+            for(int p=0; p < pixelCount; ++p)
+            {
+                const TileIterator& pixel = _packetPixels[p];
+                sampleCounts[p] = _useStochasticTracing ?
+                    pixel.sampleCount() : 1;
+                firstSamples[p] = pixel.firstSample();
+                maxCycleCount = glm::max(maxCycleCount, sampleCounts[p]);
+            }
 
+            unsigned int pixelCycleCount = 0;
             while(_runningPredicate &&
-                  totalWeightSum < multipliedWeightSum &&
                   ++pixelCycleCount <= maxCycleCount)
             {
-                if(_useDepthOfField && _aperture > 0.0)
+                _rayPacket.clear();
+                for(int p=0; p < pixelCount; ++p)
                 {
-                    glm::dvec2 confusionPos = _diskRand.gen(_aperture);
-                    raycast.origin = _camPos +
-                        _confusionSide * confusionPos.x +
-                        _confusionUp * confusionPos.y;
+                    if(pixelCycleCount <= sampleCounts[p])
+                    {
+                        glm::ivec2 pixel = _packetPixels[p].position();
+                        uint32_t sample = firstSamples[p] + pixelCycleCount - 1;
+                        laneSamples[_rayPacket.size()] = sample;
+                        random.setSample(pixel.x + pixel.y * frameWidth, sample);
+
+                        // First pair jitters the pixel, second one
+                        // samples the aperture
+                        glm::dvec2 pixPos = glm::dvec2(pixel);
+                        if(_usePixelJittering)
+                        {
+                            pixPos += _stratifiedRand.gen2() - glm::dvec2(0.5);
+                        }
+
+                        if(_useDepthOfField && _aperture > 0.0)
+                        {
+                            glm::dvec2 confusionPos = _diskRand.gen(_aperture);
+                            raycast.origin = _camPos +
+                                _confusionSide * confusionPos.x +
+                                _confusionUp * confusionPos.y;
+                        }
+
+                        glm::dvec4 screenPos((frameOrig + pixPos)*pixelSize, -1.0, 1.0);
+                        glm::dvec4 dirH = _viewProjInverse * screenPos;
+                        glm::dvec3 pixWorldPos = glm::dvec3(dirH / dirH.w);
+                        raycast.direction = glm::normalize(pixWorldPos - raycast.origin);
+                        raycast.invDir = 1.0 / raycast.direction;
+
+                        pixelLanes[_rayPacket.size()] = p;
+                        _rayPacket.add(raycast);
+                    }
                 }
 
-                glm::dvec2 pixPos = glm::dvec2(it.position());
-                glm::dvec4 screenPos((frameOrig + pixPos)*pixelSize, -1.0, 1.0);
-                glm::dvec4 dirH = _viewProjInverse * screenPos;
-                glm::dvec3 pixWorldPos = glm::dvec3(dirH / dirH.w);
-                raycast.direction = glm::normalize(pixWorldPos - raycast.origin);
-                raycast.invDir = 1.0 / raycast.direction;
+                int laneCount = _rayPacket.size();
+                if(laneCount == 0)
+                    break;
 
-                glm::dvec4 sample = fireScreenRay(raycast);
+                // Find primary hits for the whole packet at once
+                _packetReports.assign(laneCount, nullReport);
+                _searchStructure->findNearestIntersections(
+                    _rayPacket, _packetReports.data(),
+                    _rayHitList, _hitCounters.get());
 
-                if(sample.w > 0.0)
+                // Then let each path bounce on its own
+                for(int l=0; l < laneCount && _runningPredicate; ++l)
                 {
-                    it.addSample(sample);
-                    totalWeightSum += sample.w;
+                    Raycast eyeRay = _rayPacket.ray(l);
+                    eyeRay.limit = raycast.limit;
+
+                    glm::ivec2 pixel = _packetPixels[pixelLanes[l]].position();
+                    random.setSample(pixel.x + pixel.y * frameWidth,
+                                     laneSamples[l]);
+
+                    glm::dvec4 sample = fireScreenRay(
+                        eyeRay, _packetReports[l]);
+
+                    // Null samples still use up their index
+                    int p = pixelLanes[l];
+                    _scratchTile.addSample(
+                        _packetPixels[p].position(), sample);
                 }
             }
         }
-
-        _workingFilm->tileCompleted(*tile);
     }
 
     glm::dvec4 CpuRaytracerWorker::fireScreenRay(
-            const Raycast& fromEyeRay)
+            const Raycast& fromEyeRay,
+            const RayHitReport& eyeHitReport)
     {
         _workingSample = glm::dvec4(0);
 
@@ -325,9 +433,13 @@ namespace prop3
         _rayBounceArray.clear();
         _rayBounceArray.push_back(fromEyeRay);
 
+        cellar::RandomStream& random = cellar::RandomStream::local();
+        bool singlePath = _useSinglePathBounces;
+
         while(rayId < _rayBounceArray.size())
         {
             Raycast ray = _rayBounceArray[rayId];
+            random.setBounce(rayId + 1);
 
             const Coating* nullCoat = nullptr;
             const Material* nullMat = nullptr;
@@ -336,125 +448,156 @@ namespace prop3
                     nullVec3, nullVec3, nullVec3, nullCoat, nullMat, nullMat);
 
             // Find nearest ray-surface intersection
-            double hitDistance = _searchStructure->
-                findNearestIntersection(ray, reportMin, _rayHitList);
+            double hitDistance;
+            if(rayId == 0)
+            {
+                reportMin = eyeHitReport;
+                hitDistance = reportMin.length;
+            }
+            else
+            {
+                hitDistance = _searchStructure->
+                    findNearestIntersection(ray, reportMin,
+                        _rayHitList, _hitCounters.get());
+            }
             reportMin.compile(ray.direction);
 
             // If non-stochatic draft is active
             if(!_useStochasticTracing)
-            {
-                if(hitDistance == Raycast::BACKDROP_LIMIT)
-                {
-                    glm::dvec4 sample = _backdrop->raycast(ray);
-                    return glm::dvec4(glm::dvec3(sample) / sample.w,
-                                      ArtDirectorServer::IMAGE_DEPTH);
-                }
-                else
-                {
-                    double depth = hitDistance * glm::dot(ray.direction, _camDir);
-                    return glm::dvec4(draft(reportMin), depth);
-                }
-            }
+                return draftSample(ray, reportMin, hitDistance);
+
+            shadeRay(ray, reportMin, hitDistance, bounceCount);
 
 
-            // Compute maximum travelled distance in current material
-            double matPathLen = Raycast::BACKDROP_LIMIT;
-            const Material* currMat = reportMin.currMaterial;
-            if(currMat == nullptr)
+            // Check bounce group end
+            if(++rayId == rayBatchEnd)
             {
-                currMat = _ambMaterial.get();
-                if(glm::length(ray.origin) < _backdrop->distance(ray))
-                    matPathLen = currMat->lightFreePathLength(ray);
-                if(matPathLen > _backdrop->distance(ray) * 1.5)
-                    matPathLen = Raycast::BACKDROP_LIMIT;
+                // Check if we are satisfied with accumulated samples.
+                // Single paths end by russian roulette instead.
+                if(!singlePath &&
+                   bounceCount >= _sufficientScreenRayBounce &&
+                   _workingSample.w >= _sufficientScreenRayWeight)
+                    break;
+
+                rayBatchEnd = _rayBounceArray.size();
+                ++bounceCount;
             }
-            else
-            {
+        }
+
+        return _workingSample;
+    }
+
+    glm::dvec4 CpuRaytracerWorker::draftSample(
+            const Raycast& ray,
+            const RayHitReport& hitReport,
+            double hitDistance)
+    {
+        if(hitDistance == Raycast::BACKDROP_LIMIT)
+        {
+            glm::dvec4 sample = _backdrop->raycast(ray);
+            return glm::dvec4(glm::dvec3(sample) / sample.w,
+                              ArtDirectorServer::IMAGE_DEPTH);
+        }
+        else
+        {
+            double depth = hitDistance * glm::dot(ray.direction, _camDir);
+            return glm::dvec4(draft(hitReport), depth);
+        }
+    }
+
+    void CpuRaytracerWorker::shadeRay(
+            const Raycast& ray,
+            const RayHitReport& hitReport,
+            double hitDistance,
+            int bounceCount)
+    {
+        // Compute maximum travelled distance in current material
+        double matPathLen = Raycast::BACKDROP_LIMIT;
+        const Material* currMat = hitReport.currMaterial;
+        if(currMat == nullptr)
+        {
+            currMat = _ambMaterial.get();
+            if(glm::length(ray.origin) < _backdrop->distance(ray))
                 matPathLen = currMat->lightFreePathLength(ray);
-            }
+            if(matPathLen > _backdrop->distance(ray) * 1.5)
+                matPathLen = Raycast::BACKDROP_LIMIT;
+        }
+        else
+        {
+            matPathLen = currMat->lightFreePathLength(ray);
+        }
 
 
-            if(matPathLen == Raycast::BACKDROP_LIMIT &&
-               hitDistance == Raycast::BACKDROP_LIMIT)
+        if(matPathLen == Raycast::BACKDROP_LIMIT &&
+           hitDistance == Raycast::BACKDROP_LIMIT)
+        {
+            if(_backdrop.get() != nullptr)
             {
-                if(_backdrop.get() != nullptr)
-                {
-                    Raycast backRay = ray;
-                    backRay.pathLength += backRay.limit;
-                    backRay.virtDist += backRay.limit * backRay.entropy;
-                    backRay.limit = _backdrop->distance(backRay);
-                    glm::dvec4 matAtt = currMat->lightAttenuation(backRay);
-                    commitSample(backRay.sample * matAtt * _backdrop->raycast(backRay));
-                }
+                Raycast backRay = ray;
+                backRay.pathLength += backRay.limit;
+                backRay.virtDist += backRay.limit * backRay.entropy;
+                backRay.limit = _backdrop->distance(backRay);
+                glm::dvec4 matAtt = currMat->lightAttenuation(backRay);
+                commitSample(backRay.sample * matAtt * _backdrop->raycast(backRay));
             }
-            else if(hitDistance < matPathLen)
-            {
-                Raycast brdfRay = ray;
-                brdfRay.limit = hitDistance;
-                brdfRay.pathLength += brdfRay.limit;
-                brdfRay.virtDist += brdfRay.limit * brdfRay.entropy;
-
-                glm::dvec4 matAtt = currMat->lightAttenuation(brdfRay);
-                brdfRay.sample = brdfRay.sample * matAtt;
+        }
+        else if(hitDistance < matPathLen)
+        {
+            Raycast brdfRay = ray;
+            brdfRay.limit = hitDistance;
+            brdfRay.pathLength += brdfRay.limit;
+            brdfRay.virtDist += brdfRay.limit * brdfRay.entropy;
 
-                const Coating* coating = reportMin.coating;
+            glm::dvec4 matAtt = currMat->lightAttenuation(brdfRay);
+            brdfRay.sample = brdfRay.sample * matAtt;
 
+            const Coating* coating = hitReport.coating;
 
-                // Direct lighting
-                gatherReflectedLight(
-                    *coating,
-                    reportMin,
-                    brdfRay);
 
-                // Inderect lighting
-                if(bounceCount < _maxScreenBounceCount)
-                {
-                    commitSample(brdfRay.sample *
-                        coating->indirectBrdf(
-                            _tempChildRayArray,
-                            reportMin,
-                            brdfRay));
+            // Direct lighting
+            gatherReflectedLight(
+                *coating,
+                hitReport,
+                brdfRay);
 
-                    commitBounce(brdfRay);
-                }
-            }
-            else
+            // Inderect lighting
+            if(bounceCount < _maxScreenBounceCount)
             {
-                Raycast scatterRay = ray;
-                scatterRay.limit = matPathLen;
-                scatterRay.pathLength += scatterRay.limit;
-                scatterRay.virtDist += scatterRay.limit * scatterRay.entropy;
+                glm::dvec4 emission = coating->indirectBrdf(
+                        _tempChildRayArray,
+                        hitReport,
+                        brdfRay);
 
-                glm::dvec4 matAtt = currMat->lightAttenuation(scatterRay);
-                scatterRay.sample = scatterRay.sample * matAtt;
+                // Lights may also have been sampled directly
+                if(ray.density > 0.0)
+                    emission *= emissionWeight(*coating, hitReport, ray);
 
-                // Inderect lighting
-                if(bounceCount < _maxScreenBounceCount)
-                {
-                    // Inderect lighting
-                    currMat->scatterLight(
-                        _tempChildRayArray,
-                        scatterRay);
+                commitSample(brdfRay.sample * emission);
 
-                    commitBounce(scatterRay);
-                }
+                commitBounce(brdfRay, bounceCount);
             }
+        }
+        else
+        {
+            Raycast scatterRay = ray;
+            scatterRay.limit = matPathLen;
+            scatterRay.pathLength += scatterRay.limit;
+            scatterRay.virtDist += scatterRay.limit * scatterRay.entropy;
 
+            glm::dvec4 matAtt = currMat->lightAttenuation(scatterRay);
+            scatterRay.sample = scatterRay.sample * matAtt;
 
-            // Check bounce group end
-            if(++rayId == rayBatchEnd)
+            // Inderect lighting
+            if(bounceCount < _maxScreenBounceCount)
             {
-                // Check if we are satisfied with accumulated samples
-                if(bounceCount >= _sufficientScreenRayBounce &&
-                   _workingSample.w >= _sufficientScreenRayWeight)
-                    break;
+                // Inderect lighting
+                currMat->scatterLight(
+                    _tempChildRayArray,
+                    scatterRay);
 
-                rayBatchEnd = _rayBounceArray.size();
-                ++bounceCount;
+                commitBounce(scatterRay, bounceCount);
             }
         }
-
-        return _workingSample;
     }
 
     void CpuRaytracerWorker::gatherReflectedLight(
@@ -462,10 +605,47 @@ namespace prop3
             const RayHitReport& hitReport,
             const Raycast& outRay)
     {
-        _lightRays.clear();        
+        _lightRays.clear();
+        _lightCastSlots.clear();
+
+        // Each light's casts remember the last surface that
+        // occluded them. Backdrop's slots come after lights' ones.
+        const auto& lights = _searchStructure->lights();
+        size_t backdropSlot = lights.size() * _lightDirectRayCount;
         _backdrop->fireOn(_lightRays, hitReport.position, _lightDirectRayCount);
-        for(const auto& light : _searchStructure->lights())
-            light->fireOn(_lightRays, hitReport.position, _lightDirectRayCount);
+        for(size_t c=0; c < _lightRays.size(); ++c)
+            _lightCastSlots.push_back(backdropSlot + c);
+
+        size_t slotCount = backdropSlot + _lightRays.size();
+        if(_lightOccluders.size() < slotCount)
+            _lightOccluders.resize(slotCount, SearchStructure::NO_OCCLUDER);
+
+        const LightTree& lightTree = _searchStructure->lightTree();
+        if(lights.size() <= _lightSampleCount || lightTree.isEmpty())
+        {
+            for(size_t l=0; l < lights.size(); ++l)
+                fireLight(l, hitReport.position, 1.0);
+        }
+        else
+        {
+            for(size_t l : lightTree.unboundedLights())
+                fireLight(l, hitReport.position, 1.0);
+
+            // Picked lights' casts are divided by their probability
+            // of being picked to keep the estimate unbiased
+            for(unsigned int s=0; s < _lightSampleCount; ++s)
+            {
+                size_t lightId;
+                double probability;
+                if(lightTree.sample(hitReport.position,
+                                    _linearRand.gen1(),
+                                    lightId, probability))
+                {
+                    fireLight(lightId, hitReport.position,
+                              1.0 / (probability * _lightSampleCount));
+                }
+            }
+        }
 
         size_t lightCastCount = _lightRays.size();
         for(size_t c=0; c < lightCastCount; ++c)
@@ -495,20 +675,95 @@ namespace prop3
 
                 if(pathSamp.w > _minScreenRayWeight)
                 {
-                    if(!_searchStructure->intersectsScene(
-                            lightRay, _rayHitList, outRay.entropy))
-                    {
-                        commitSample(pathSamp *
-                             coating.directBrdf(
-                                 lightCast,
-                                 shadowReport,
-                                 outRay));
-                    }
+                    connectLight(coating, lightCast, shadowReport,
+                                 outRay, pathSamp, _lightCastSlots[c]);
                 }
             }
         }
     }
 
+    void CpuRaytracerWorker::connectLight(
+            const Coating& coating,
+            const LightCast& lightCast,
+            const RayHitReport& shadowReport,
+            const Raycast& outRay,
+            const glm::dvec4& pathSample,
+            size_t occluderSlot)
+    {
+        if(!_searchStructure->intersectsScene(
+                lightCast.raycast, _rayHitList, _hitCounters.get(),
+                outRay.entropy, _lightOccluders[occluderSlot]))
+        {
+            commitSample(pathSample *
+                 coating.directBrdf(
+                     lightCast,
+                     shadowReport,
+                     outRay));
+        }
+    }
+
+    void CpuRaytracerWorker::fireLight(
+            size_t lightId,
+            const glm::dvec3& position,
+            double weight)
+    {
+        size_t begCast = _lightRays.size();
+        _searchStructure->lights()[lightId]->fireOn(
+            _lightRays, position, _lightDirectRayCount);
+
+        size_t endCast = _lightRays.size();
+        for(size_t c=begCast; c < endCast; ++c)
+        {
+            LightCast& lightCast = _lightRays[c];
+            lightCast.raycast.sample *= weight;
+            lightCast.density = lightDensity(
+                lightId, position, lightCast.emittingPosition);
+
+            _lightCastSlots.push_back(
+                lightId * _lightDirectRayCount + (c - begCast));
+        }
+    }
+
+    double CpuRaytracerWorker::lightDensity(
+            size_t lightId,
+            const glm::dvec3& position,
+            const glm::dvec3& source) const
+    {
+        const auto& lights = _searchStructure->lights();
+        const LightTree& lightTree = _searchStructure->lightTree();
+
+        // Expected count of times the light gets picked
+        double pickCount = 1.0;
+        if(lights.size() > _lightSampleCount && lightTree.isPickable(lightId))
+            pickCount = lightTree.probability(position, lightId) * _lightSampleCount;
+
+        return pickCount * _lightDirectRayCount *
+                lights[lightId]->castDensity(source, position);
+    }
+
+    double CpuRaytracerWorker::emissionWeight(
+            const Coating& coating,
+            const RayHitReport& hitReport,
+            const Raycast& ray) const
+    {
+        const EmissiveCoating* emissive =
+            dynamic_cast<const EmissiveCoating*>(&coating);
+        if(emissive == nullptr)
+            return 1.0;
+
+        // Lights are only sampled from the ambient material
+        const Material* currMaterial = hitReport.currMaterial;
+        if(currMaterial != nullptr && currMaterial != _ambMaterial.get())
+            return 1.0;
+
+        size_t lightId = _searchStructure->lightId(&emissive->lightBulb());
+        if(lightId == LightTree::NO_LIGHT)
+            return 1.0;
+
+        double density = lightDensity(lightId, ray.origin, hitReport.position);
+        return Raycast::powerHeuristic(ray.density, density);
+    }
+
     glm::dvec3 CpuRaytracerWorker::draft(
         const RayHitReport& report)
     {
@@ -529,8 +784,15 @@ namespace prop3
     }
 
     inline void CpuRaytracerWorker::commitBounce(
-            const Raycast& inRay)
+            const Raycast& inRay,
+            int bounceCount)
     {
+        if(_useSinglePathBounces)
+        {
+            commitSinglePath(inRay, bounceCount);
+            return;
+        }
+
         size_t childCount = _tempChildRayArray.size();
         for(size_t i=0; i < childCount; ++i)
         {
@@ -559,4 +821,53 @@ namespace prop3
 
         _tempChildRayArray.clear();
     }
+
+    void CpuRaytracerWorker::commitSinglePath(
+            const Raycast& inRay,
+            int bounceCount)
+    {
+        // Pick a single lobe in proportion to its weight
+        double weightSum = 0.0;
+        for(const Raycast& childRay : _tempChildRayArray)
+            weightSum += glm::max(childRay.sample.w, 0.0);
+
+        if(weightSum <= 0.0)
+        {
+            _tempChildRayArray.clear();
+            return;
+        }
+
+        size_t pick = 0;
+        double u = _linearRand.gen1(weightSum);
+        size_t lastChild = _tempChildRayArray.size() - 1;
+        while(pick < lastChild &&
+              (u -= glm::max(_tempChildRayArray[pick].sample.w, 0.0)) >= 0.0)
+            ++pick;
+
+        // Dividing by the pick probability keeps the path unbiased
+        Raycast childRay = _tempChildRayArray[pick];
+        _tempChildRayArray.clear();
+        if(childRay.sample.w <= 0.0)
+            return;
+
+        childRay.sample *= inRay.sample * (weightSum / childRay.sample.w);
+
+        // Russian roulette on the path's throughput
+        if(bounceCount >= int(_rouletteStartBounce))
+        {
+            double survival = glm::min(1.0, glm::max(childRay.sample.r,
+                glm::max(childRay.sample.g, childRay.sample.b)));
+
+            if(survival <= 0.0 || _linearRand.gen1() >= survival)
+                return;
+
+            childRay.sample /= survival;
+        }
+
+        childRay.entropy = Raycast::mixEntropies(inRay.entropy, childRay.entropy);
+        childRay.pathLength = inRay.pathLength;
+        childRay.virtDist = inRay.virtDist;
+
+        _rayBounceArray.push_back(childRay);
+    }
 }
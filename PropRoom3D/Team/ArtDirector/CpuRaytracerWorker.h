@@ -15,21 +15,21 @@
 #include <CellarWorkbench/Misc/Distribution.h>
 
 #include <PropRoom3D/Ray/RayHitList.h>
+#include <PropRoom3D/Ray/RayHitReport.h>
+#include <PropRoom3D/Ray/RayPacket.h>
+#include <PropRoom3D/Team/ArtDirector/Film/Tile.h>
+#include <PropRoom3D/Team/ArtDirector/Film/ScratchTile.h>
+#include <PropRoom3D/Team/ArtDirector/SearchStructure.h>
 
 
 namespace prop3
 {
     class Raycast;
     class LightCast;
-    class RayHitReport;
     class StageSet;
     class Backdrop;
 
-    class SearchStructure;
-
     class Film;
-    class Tile;
-    class TileIterator;
 
 
 
@@ -39,7 +39,8 @@ namespace prop3
         static void launchWorker(
             const std::shared_ptr<CpuRaytracerWorker>& worker);
 
-        CpuRaytracerWorker();
+        // Worker id selects the worker's own deque of tiles
+        CpuRaytracerWorker(size_t workerId);
         virtual ~CpuRaytracerWorker();
 
         // States
@@ -62,6 +63,11 @@ namespace prop3
         virtual void usePixelJittering(bool use);
         virtual void useDepthOfField(bool use);
 
+        // Follows a single lobe per interaction, ending paths by
+        // russian roulette, instead of expanding a tree of rays
+        virtual void useSinglePathBounces(bool use);
+        virtual void useSampleSequence(cellar::RandomStream::Sequence sequence);
+
     protected:
         virtual void skipAndExecute(const std::function<void()>& func);
 
@@ -70,22 +76,67 @@ namespace prop3
         virtual void shootFromScreen(
                 std::shared_ptr<Tile>& tile);
 
+        // Primary hits are found ahead by packet traversal
         virtual glm::dvec4 fireScreenRay(
-                const Raycast& fromEyeRay);
+                const Raycast& fromEyeRay,
+                const RayHitReport& eyeHitReport);
+
+        // Color and depth of non-stochastic drafts
+        glm::dvec4 draftSample(
+                const Raycast& ray,
+                const RayHitReport& hitReport,
+                double hitDistance);
+
+        // Shades a ray whose nearest hit is known. Light reaching the
+        // eye is committed to the working sample and child rays are
+        // appended to the bounce array.
+        void shadeRay(
+                const Raycast& ray,
+                const RayHitReport& hitReport,
+                double hitDistance,
+                int bounceCount);
 
         virtual void gatherReflectedLight(
                 const Coating& coating,
                 const RayHitReport& hitReport,
                 const Raycast& outRay);
 
+        // Commits a light cast's contribution if nothing occludes it
+        virtual void connectLight(
+                const Coating& coating,
+                const LightCast& lightCast,
+                const RayHitReport& shadowReport,
+                const Raycast& outRay,
+                const glm::dvec4& pathSample,
+                size_t occluderSlot);
+
+        // Appends light's casts, their samples scaled by weight
+        void fireLight(size_t lightId,
+                       const glm::dvec3& position,
+                       double weight);
+
+        // Solid angle density at which direct lighting of position
+        // reaches it from source, on the light
+        double lightDensity(size_t lightId,
+                            const glm::dvec3& position,
+                            const glm::dvec3& source) const;
+
+        // Multiple importance sampling weight of emission found by
+        // a coating lobe's ray, against direct lighting
+        double emissionWeight(const Coating& coating,
+                              const RayHitReport& hitReport,
+                              const Raycast& ray) const;
+
 
         virtual glm::dvec3 draft(const RayHitReport& report);
 
         void commitSample(const glm::dvec4& sample);
-        void commitBounce(const Raycast& inRay);
+        void commitBounce(const Raycast& inRay, int bounceCount);
+        void commitSinglePath(const Raycast& inRay, int bounceCount);
 
 
-    private:
+    protected:
+        size_t _workerId;
         std::atomic<bool> _runningPredicate;
         std::atomic<bool> _terminatePredicate;
         std::condition_variable _cv;
@@ -95,13 +146,17 @@ namespace prop3
         std::atomic<bool> _useStochasticTracing;
         std::atomic<bool> _usePixelJittering;
         std::atomic<bool> _useDepthOfField;
+        std::atomic<bool> _useSinglePathBounces;
+        std::atomic<cellar::RandomStream::Sequence> _sampleSequence;
 
         unsigned int _lightDirectRayCount;
+        unsigned int _lightSampleCount;
         unsigned int _maxScreenBounceCount;
         double _screenRayIntensityThreshold;
         unsigned int _sufficientScreenRayBounce;
         double _sufficientScreenRayWeight;
         double _minScreenRayWeight;
+        unsigned int _rouletteStartBounce;
 
         glm::ivec2 _resolution;
         glm::dmat4 _viewInvMatrix;
@@ -121,17 +176,25 @@ namespace prop3
         std::shared_ptr<Backdrop> _backdrop;
         std::shared_ptr<Material> _ambMaterial;
         std::shared_ptr<SearchStructure> _searchStructure;
+        std::shared_ptr<HitCounters> _hitCounters;
 
         //std::vector<RayHitReport> _lightHitReports;
 
         // Memory pools
         RayHitList _rayHitList;
         std::vector<LightCast> _lightRays;
+        std::vector<size_t> _lightOccluders;
+        std::vector<size_t> _lightCastSlots;
         std::vector<Raycast> _rayBounceArray;
         std::vector<Raycast> _tempChildRayArray;
+        std::vector<TileIterator> _packetPixels;
+        ScratchTile _scratchTile;
+        std::vector<RayHitReport> _packetReports;
+        RayPacket _rayPacket;
 
         // Random distribution
         cellar::LinearRand _linearRand;
+        cellar::StratifiedRand _stratifiedRand;
         cellar::DiskRand _diskRand;
     };
 }
@@ -0,0 +1,329 @@
+#include "CpuWavefrontWorker.h"
+
+#include <numeric>
+#include <algorithm>
+#include <typeindex>
+
+#include "Node/Prop/Coating/Coating.h"
+
+#include "Ray/Raycast.h"
+#include "Ray/RayHitReport.h"
+#include "SearchStructure.h"
+
+#include "Node/Light/LightCast.h"
+
+#include "Film/Film.h"
+
+
+namespace prop3
+{
+    void CpuWavefrontWorker::RayQueue::clear()
+    {
+        rays.clear();
+        paths.clear();
+        reports.clear();
+        hitDistances.clear();
+    }
+
+    void CpuWavefrontWorker::RayQueue::push(const Raycast& ray, size_t path)
+    {
+        rays.push_back(ray);
+        paths.push_back(path);
+    }
+
+    void CpuWavefrontWorker::ShadowQueue::clear()
+    {
+        rays.clear();
+        paths.clear();
+        occluderSlots.clear();
+        entropies.clear();
+        samples.clear();
+    }
+
+    void CpuWavefrontWorker::ShadowQueue::push(
+            const Raycast& ray,
+            size_t path,
+            size_t slot,
+            double entropy,
+            const glm::dvec4& sample)
+    {
+        rays.push_back(ray);
+        paths.push_back(path);
+        occluderSlots.push_back(slot);
+        entropies.push_back(entropy);
+        samples.push_back(sample);
+    }
+
+
+    CpuWavefrontWorker::CpuWavefrontWorker(size_t workerId) :
+        CpuRaytracerWorker(workerId),
+        _shadingPath(0)
+    {
+    }
+
+    CpuWavefrontWorker::~CpuWavefrontWorker()
+    {
+    }
+
+    void CpuWavefrontWorker::shootFromScreen(std::shared_ptr<Tile>& tile)
+    {
+        generate(tile);
+
+        int bounceCount = 1;
+        while(_rayQueue.size() > 0 && _runningPredicate)
+        {
+            extend(bounceCount == 1);
+            shade(bounceCount);
+            connect();
+            advance(bounceCount);
+            ++bounceCount;
+        }
+
+        // Interrupted paths would darken their pixels
+        if(_rayQueue.size() == 0)
+            accumulate();
+    }
+
+    void CpuWavefrontWorker::generate(std::shared_ptr<Tile>& tile)
+    {
+        double pixelWidth = 2.0 / _workingFilm->frameWidth();
+        double pixelHeight = 2.0 / _workingFilm->frameHeight();
+        glm::dvec2 pixelSize(pixelWidth, pixelHeight);
+        glm::dvec2 frameOrig = -glm::dvec2(_workingFilm->frameResolution()) / 2.0;
+        int frameWidth = _workingFilm->frameWidth();
+
+        cellar::RandomStream& random = cellar::RandomStream::local();
+        random.setSequence(_sampleSequence);
+
+        Raycast raycast(
+            Raycast::FULLY_SPECULAR,
+            glm::dvec4(1.0),
+            _camPos,
+            glm::dvec3(0.0));
+
+        _pathPixels.clear();
+        _pathSampleIds.clear();
+        _pathRayCounts.clear();
+        _pathSamples.clear();
+        _rayQueue.clear();
+
+        _packetPixels.clear();
+        unsigned int maxCycleCount = 0;
+        for(TileIterator it = tile->begin(); it != tile->end(); ++it)
+        {
+            _packetPixels.push_back(it);
+            maxCycleCount = glm::max(maxCycleCount, _useStochasticTracing ?
+                it.sampleCount() : 1);
+        }
+
+        // Neighbor pixels' samples of a same cycle are queued
+        // together so that primary rays form coherent packets
+        for(unsigned int cycle=1; cycle <= maxCycleCount; ++cycle)
+        {
+            for(const TileIterator& it : _packetPixels)
+            {
+                unsigned int sampleCount = _useStochasticTracing ?
+                    it.sampleCount() : 1;
+                if(cycle > sampleCount)
+                    continue;
+
+                glm::ivec2 pixel = it.position();
+                uint32_t sample = it.firstSample() + cycle - 1;
+                random.setSample(pixel.x + pixel.y * frameWidth, sample);
+
+                // First pair jitters the pixel, second one
+                // samples the aperture
+                glm::dvec2 pixPos = glm::dvec2(pixel);
+                if(_usePixelJittering)
+                {
+                    pixPos += _stratifiedRand.gen2() - glm::dvec2(0.5);
+                }
+
+                if(_useDepthOfField && _aperture > 0.0)
+                {
+                    glm::dvec2 confusionPos = _diskRand.gen(_aperture);
+                    raycast.origin = _camPos +
+                        _confusionSide * confusionPos.x +
+                        _confusionUp * confusionPos.y;
+                }
+
+                glm::dvec4 screenPos((frameOrig + pixPos)*pixelSize, -1.0, 1.0);
+                glm::dvec4 dirH = _viewProjInverse * screenPos;
+                glm::dvec3 pixWorldPos = glm::dvec3(dirH / dirH.w);
+                raycast.direction = glm::normalize(pixWorldPos - raycast.origin);
+                raycast.invDir = 1.0 / raycast.direction;
+
+                _rayQueue.push(raycast, _pathPixels.size());
+                _pathPixels.push_back(pixel);
+                _pathSampleIds.push_back(sample);
+                _pathRayCounts.push_back(0);
+                _pathSamples.push_back(glm::dvec4(0.0));
+            }
+        }
+    }
+
+    void CpuWavefrontWorker::extend(bool primaryRays)
+    {
+        const Coating* nullCoat = nullptr;
+        const Material* nullMat = nullptr;
+        const glm::dvec3 nullVec3 = glm::dvec3();
+        const RayHitReport nullReport(Raycast::BACKDROP_LIMIT,
+                nullVec3, nullVec3, nullVec3, nullCoat, nullMat, nullMat);
+
+        size_t rayCount = _rayQueue.size();
+        _rayQueue.reports.assign(rayCount, nullReport);
+        _rayQueue.hitDistances.assign(rayCount, Raycast::BACKDROP_LIMIT);
+
+        if(primaryRays)
+        {
+            for(size_t r=0; r < rayCount; r += RayPacket::LANE_COUNT)
+            {
+                _rayPacket.clear();
+                size_t endRay = glm::min(r + RayPacket::LANE_COUNT, rayCount);
+                for(size_t l=r; l < endRay; ++l)
+                    _rayPacket.add(_rayQueue.rays[l]);
+
+                _searchStructure->findNearestIntersections(
+                    _rayPacket, &_rayQueue.reports[r],
+                    _rayHitList, _hitCounters.get());
+
+                for(size_t l=r; l < endRay; ++l)
+                    _rayQueue.hitDistances[l] = _rayQueue.reports[l].length;
+            }
+        }
+        else
+        {
+            for(size_t r=0; r < rayCount; ++r)
+            {
+                _rayQueue.hitDistances[r] = _searchStructure->
+                    findNearestIntersection(_rayQueue.rays[r],
+                        _rayQueue.reports[r], _rayHitList,
+                        _hitCounters.get());
+            }
+        }
+
+        for(size_t r=0; r < rayCount; ++r)
+            _rayQueue.reports[r].compile(_rayQueue.rays[r].direction);
+    }
+
+    void CpuWavefrontWorker::shade(int bounceCount)
+    {
+        int frameWidth = _workingFilm->frameWidth();
+        cellar::RandomStream& random = cellar::RandomStream::local();
+
+        // Rays hitting the same kind of coating are shaded in a row
+        // so that they run the same code. Backdrop hits come first.
+        const std::vector<RayHitReport>& reports = _rayQueue.reports;
+        _shadingOrder.resize(_rayQueue.size());
+        std::iota(_shadingOrder.begin(), _shadingOrder.end(), 0);
+        std::sort(_shadingOrder.begin(), _shadingOrder.end(),
+            [&reports](size_t r1, size_t r2){
+                const Coating* c1 = reports[r1].coating;
+                const Coating* c2 = reports[r2].coating;
+                if(c1 == nullptr || c2 == nullptr)
+                    return c1 == nullptr && c2 != nullptr;
+
+                std::type_index t1(typeid(*c1));
+                std::type_index t2(typeid(*c2));
+                if(t1 != t2)
+                    return t1 < t2;
+                return c1 < c2;
+        });
+
+        _childQueue.clear();
+        _shadowQueue.clear();
+
+        for(size_t r : _shadingOrder)
+        {
+            size_t path = _rayQueue.paths[r];
+            const Raycast& ray = _rayQueue.rays[r];
+            const RayHitReport& hitReport = _rayQueue.reports[r];
+            double hitDistance = _rayQueue.hitDistances[r];
+
+            glm::ivec2 pixel = _pathPixels[path];
+            random.setSample(pixel.x + pixel.y * frameWidth,
+                             _pathSampleIds[path]);
+            random.setBounce(++_pathRayCounts[path]);
+
+            // If non-stochatic draft is active
+            if(!_useStochasticTracing)
+            {
+                _pathSamples[path] = draftSample(ray, hitReport, hitDistance);
+                continue;
+            }
+
+            _shadingPath = path;
+            _workingSample = glm::dvec4(0);
+            _rayBounceArray.clear();
+
+            shadeRay(ray, hitReport, hitDistance, bounceCount);
+
+            _pathSamples[path] += _workingSample;
+            for(const Raycast& childRay : _rayBounceArray)
+                _childQueue.push(childRay, path);
+        }
+    }
+
+    void CpuWavefrontWorker::connect()
+    {
+        size_t shadowCount = _shadowQueue.size();
+        for(size_t s=0; s < shadowCount; ++s)
+        {
+            size_t& occluder = _lightOccluders[_shadowQueue.occluderSlots[s]];
+            if(!_searchStructure->intersectsScene(
+                    _shadowQueue.rays[s], _rayHitList, _hitCounters.get(),
+                    _shadowQueue.entropies[s], occluder))
+            {
+                _pathSamples[_shadowQueue.paths[s]] += _shadowQueue.samples[s];
+            }
+        }
+    }
+
+    void CpuWavefrontWorker::advance(int bounceCount)
+    {
+        // Check if paths are satisfied with accumulated samples.
+        // Single paths end by russian roulette instead.
+        bool checkSufficiency = !_useSinglePathBounces &&
+            bounceCount >= int(_sufficientScreenRayBounce);
+
+        _rayQueue.clear();
+        size_t childCount = _childQueue.size();
+        for(size_t c=0; c < childCount; ++c)
+        {
+            size_t path = _childQueue.paths[c];
+            if(checkSufficiency &&
+               _pathSamples[path].w >= _sufficientScreenRayWeight)
+                continue;
+
+            _rayQueue.push(_childQueue.rays[c], path);
+        }
+    }
+
+    void CpuWavefrontWorker::accumulate()
+    {
+        size_t pathCount = _pathSamples.size();
+        // Null samples still use up their index
+        for(size_t p=0; p < pathCount; ++p)
+            _scratchTile.addSample(_pathPixels[p], _pathSamples[p]);
+    }
+
+    void CpuWavefrontWorker::connectLight(
+            const Coating& coating,
+            const LightCast& lightCast,
+            const RayHitReport& shadowReport,
+            const Raycast& outRay,
+            const glm::dvec4& pathSample,
+            size_t occluderSlot)
+    {
+        // Light's contribution is evaluated while the shading
+        // point is at hand. Only its visibility is deferred.
+        glm::dvec4 sample = pathSample *
+            coating.directBrdf(lightCast, shadowReport, outRay);
+
+        if(sample == glm::dvec4(0.0))
+            return;
+
+        _shadowQueue.push(lightCast.raycast, _shadingPath,
+                          occluderSlot, outRay.entropy, sample);
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef PROPROOM3D_CPUWAVEFRONTWORKER_H
+#define PROPROOM3D_CPUWAVEFRONTWORKER_H
+
+#include "CpuRaytracerWorker.h"
+
+
+namespace prop3
+{
+    // Traces every pixel sample of a sub-tile together, one
+    // generation of bounces at a time. Each generation goes through
+    // batched stages : rays are extended to their nearest hit, shaded
+    // grouped by coating type, then the shadow rays they emitted are
+    // connected to lights. Paths' samples reach the tile once all of
+    // them have ended. Workers shoot their own sub-tiles, so stages
+    // run on every core at once.
+    class PROP3D_EXPORT CpuWavefrontWorker : public CpuRaytracerWorker
+    {
+    public:
+        CpuWavefrontWorker(size_t workerId);
+        virtual ~CpuWavefrontWorker();
+
+    protected:
+        virtual void shootFromScreen(
+                std::shared_ptr<Tile>& tile) override;
+
+        // Queues eye rays of every pixel sample
+        virtual void generate(std::shared_ptr<Tile>& tile);
+
+        // Finds queued rays' nearest hits. Primary rays are
+        // coherent enough to be traversed as packets.
+        virtual void extend(bool primaryRays);
+
+        // Queues children and shadow rays of shaded rays
+        virtual void shade(int bounceCount);
+
+        // Commits shadow rays' light if nothing occludes them
+        virtual void connect();
+
+        // Keeps children of paths that still need samples
+        virtual void advance(int bounceCount);
+
+        // Adds finished paths' samples to the scratch tile
+        virtual void accumulate();
+
+        virtual void connectLight(
+                const Coating& coating,
+                const LightCast& lightCast,
+                const RayHitReport& shadowReport,
+                const Raycast& outRay,
+                const glm::dvec4& pathSample,
+                size_t occluderSlot) override;
+
+    private:
+        // Structures of arrays, one entry per ray
+        struct RayQueue
+        {
+            void clear();
+            size_t size() const;
+            void push(const Raycast& ray, size_t path);
+
+            std::vector<Raycast> rays;
+            std::vector<size_t> paths;
+            std::vector<RayHitReport> reports;
+            std::vector<double> hitDistances;
+        };
+
+        struct ShadowQueue
+        {
+            void clear();
+            size_t size() const;
+            void push(const Raycast& ray, size_t path, size_t slot,
+                      double entropy, const glm::dvec4& sample);
+
+            std::vector<Raycast> rays;
+            std::vector<size_t> paths;
+            std::vector<size_t> occluderSlots;
+            std::vector<double> entropies;
+            std::vector<glm::dvec4> samples;
+        };
+
+        // Paths, one per pixel sample
+        std::vector<glm::ivec2> _pathPixels;
+        std::vector<uint32_t> _pathSampleIds;
+        std::vector<uint32_t> _pathRayCounts;
+        std::vector<glm::dvec4> _pathSamples;
+        size_t _shadingPath;
+
+        RayQueue _rayQueue;
+        RayQueue _childQueue;
+        ShadowQueue _shadowQueue;
+        std::vector<size_t> _shadingOrder;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline size_t CpuWavefrontWorker::RayQueue::size() const
+    {
+        return rays.size();
+    }
+
+    inline size_t CpuWavefrontWorker::ShadowQueue::size() const
+    {
+        return rays.size();
+    }
+}
+
+#endif // PROPROOM3D_CPUWAVEFRONTWORKER_H
@@ -1,67 +1,39 @@
 #include "ConvergentFilm.h"
 
-#include <fstream>
 #include <algorithm>
 #include <numeric>
+#include <thread>
+#include <functional>
 
+#include <CellarWorkbench/Misc/Log.h>
+
+#include "Tile.h"
 #include "PixelPrioritizer.h"
+#include "ScratchTile.h"
+#include "RawFilmFile.h"
+
+using namespace cellar;
 
 
 namespace prop3
 {
-    const double UINT_MAX_DOUBLE = std::numeric_limits<unsigned short>::max();
-    const double ConvergentFilm::RawPixel::COLOR_SCALING = 1 / 8.0;
-    const double ConvergentFilm::RawPixel::VARIANCE_SCALING = 1 / 16.0;
-    const double ConvergentFilm::RawPixel::COLOR_DECOMPRESSION = 8.0 / UINT_MAX_DOUBLE;
-    const double ConvergentFilm::RawPixel::VARIANCE_DECOMPRESSION = 16.0 / UINT_MAX_DOUBLE;
-
-    ConvergentFilm::RawPixel::RawPixel() :
-        weight(0.0), v(0), r(0), g(0), b(0)
-    {
-
-    }
-
-    ConvergentFilm::RawPixel::RawPixel(
-            const glm::dvec4& sample,
-            const glm::dvec2& variance)
-    {
-        var = variance.x;
-        weight = sample.w;
-        double weightInv = 1 / weight;
-        vw = glm::min((weight - variance.y) * VARIANCE_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
-        r = glm::min(glm::sqrt(sample.r * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
-        g = glm::min(glm::sqrt(sample.g * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
-        b = glm::min(glm::sqrt(sample.b * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
-    }
-
-    void ConvergentFilm::RawPixel::toRaw(
-            glm::dvec4& sample,
-            glm::dvec2& variance) const
-    {
-        variance.x = var;
-        sample.w = weight;
-        variance.y = weight - vw * VARIANCE_DECOMPRESSION;
-        sample.r = r * COLOR_DECOMPRESSION;
-        sample.r = weight * (sample.r * sample.r);
-        sample.g = g * COLOR_DECOMPRESSION;
-        sample.g = weight * (sample.g * sample.g);
-        sample.b = b * COLOR_DECOMPRESSION;
-        sample.b = weight * (sample.b * sample.b);
-    }
-
-
     ConvergentFilm::ConvergentFilm() :
-        _sampleBuffer(1, glm::dvec4(0)),
-        _varianceBuffer(1, glm::dvec2(0)),
-        _compatibilityBuffer(1.0, 0.0),
-        _divergenceBuffer(1, 1.0),
-        _priorityBuffer(1, 1.0),
+        _divergenceBuffer(1, 1.0f),
+        _frontBuffer(0),
         _condifdenceRange(0.25),
         _varianceWeightThreshold(4.0),
         _divergenceWeightThreshold(8.0),
         _maxPixelIntensity(1.5),
         _prioritizer(new PixelPrioritizer())
     {
+        _sampleBuffer.reset(1);
+        for(int b=0; b < 2; ++b)
+        {
+            _priorityBuffers[b].assign(1, 1.0f);
+            _sampleCountBuffers[b].assign(1, 1);
+        }
+        _varianceBuffer.reset(1);
+
         _priorityWeightBias = 0.25 *
             _divergenceWeightThreshold *
             _divergenceWeightThreshold;
@@ -78,6 +50,29 @@ namespace prop3
 
     }
 
+    // Runs convert over contiguous pixel ranges, one per core
+    static void convertInParallel(
+            int pixelCount,
+            const std::function<void(int, int)>& convert)
+    {
+        const int MIN_RANGE_SIZE = 16384;
+        int threadCount = glm::clamp(pixelCount / MIN_RANGE_SIZE, 1,
+            glm::max(int(std::thread::hardware_concurrency()), 1));
+
+        std::vector<std::thread> threads;
+        for(int t=1; t < threadCount; ++t)
+        {
+            threads.push_back(std::thread(convert,
+                int(pixelCount * int64_t(t) / threadCount),
+                int(pixelCount * int64_t(t+1) / threadCount)));
+        }
+
+        convert(0, pixelCount / threadCount);
+
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
     const std::vector<glm::vec3>& ConvergentFilm::colorBuffer(ColorOutput colorOutput)
     {
         if(colorOutput != _colorOutput)
@@ -85,48 +80,94 @@ namespace prop3
             _colorOutput = colorOutput;
 
             int pixelCount = _frameResolution.x * _frameResolution.y;
+            convertInParallel(pixelCount, [this, colorOutput](int beg, int end){
+                convertColors(colorOutput, beg, end);
+            });
+
+            markFrameDirty();
+        }
 
-            switch(colorOutput)
+        return _colorBuffer;
+    }
+
+    void ConvergentFilm::convertColors(ColorOutput colorOutput, int beg, int end)
+    {
+        const float* r = _sampleBuffer.r.data();
+        const float* g = _sampleBuffer.g.data();
+        const float* b = _sampleBuffer.b.data();
+        const float* w = _sampleBuffer.w.data();
+        glm::vec3* color = _colorBuffer.data();
+
+        // Without a reference shot, outputs only depend on
+        // the film's own planes and are computed in a row
+        switch(colorOutput)
+        {
+        case ColorOutput::ALBEDO :
+            if(hasReferenceShot())
             {
-            case ColorOutput::ALBEDO :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = sampleToColor(_sampleBuffer[i] +
-                        _referenceFilm.sampleBuffer[i] * refCompatibility(i));
-                break;
+                for(int i=beg; i < end; ++i)
+                    color[i] = sampleToColor(_sampleBuffer.get(i) +
+                        _referenceFilm.sampleBuffer.get(i) * refCompatibility(i));
+            }
+            else
+            {
+                for(int i=beg; i < end; ++i)
+                {
+                    float wInv = w[i] > 0.0f ? 1.0f / w[i] : 0.0f;
+                    color[i] = glm::vec3(r[i], g[i], b[i]) * wInv;
+                }
+            }
+            break;
 
-            case ColorOutput::WEIGHT :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = weightToColor(_sampleBuffer[i]);
-                break;
+        case ColorOutput::WEIGHT :
+            for(int i=beg; i < end; ++i)
+                color[i] = glm::vec3(w[i] / 200.0f);
+            break;
 
-            case ColorOutput::DIVERGENCE :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = divergenceToColor(_divergenceBuffer[i]);
-                break;
+        case ColorOutput::DIVERGENCE :
+            for(int i=beg; i < end; ++i)
+                color[i] = divergenceToColor(_divergenceBuffer[i]);
+            break;
 
-            case ColorOutput::VARIANCE :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = varianceToColor(_varianceBuffer[i] +
-                        _referenceFilm.varianceBuffer[i] * refCompatibility(i));
-                break;
+        case ColorOutput::VARIANCE :
+            if(hasReferenceShot())
+            {
+                for(int i=beg; i < end; ++i)
+                    color[i] = varianceToColor(_varianceBuffer.get(i) +
+                        _referenceFilm.varianceBuffer.get(i) * refCompatibility(i));
+            }
+            else
+            {
+                const float* sum = _varianceBuffer.sum.data();
+                const float* weight = _varianceBuffer.weight.data();
+                for(int i=beg; i < end; ++i)
+                    color[i] = glm::vec3(weight[i] > 0.0f ?
+                        (sum[i] / weight[i]) * 2.0f : 1.0f);
+            }
+            break;
 
-            case ColorOutput::COMPATIBILITY :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = compatibilityToColor(refCompatibility(i));
-                break;
+        case ColorOutput::COMPATIBILITY :
+            for(int i=beg; i < end; ++i)
+                color[i] = compatibilityToColor(refCompatibility(i));
+            break;
 
-            case ColorOutput::PRIORITY :
-                _prioritizer->displayPrioritization(*this);
-                break;
+        case ColorOutput::PRIORITY :
+            for(int i=beg; i < end; ++i)
+                color[i] = priorityToColor(frontPriorities()[i]);
+            break;
 
-            case ColorOutput::REFERENCE :
-                for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = sampleToColor(_referenceFilm.sampleBuffer[i]);
-                break;
+        case ColorOutput::REFERENCE :
+            if(hasReferenceShot())
+            {
+                for(int i=beg; i < end; ++i)
+                    color[i] = sampleToColor(_referenceFilm.sampleBuffer.get(i));
+            }
+            else
+            {
+                std::fill(color + beg, color + end, glm::vec3(0.0));
             }
+            break;
         }
-
-        return _colorBuffer;
     }
 
     void ConvergentFilm::resetFilmState()
@@ -137,7 +178,6 @@ namespace prop3
         _newTileCompleted = false;
         _newFrameCompleted = false;
 
-        _nextTileId = 0;
         _framePassCount = 0;
         _priorityThreshold = 1.0;
         _sampleMultiplicity = _divergenceWeightThreshold / 2.0;
@@ -152,57 +192,77 @@ namespace prop3
             tile->setTilePriority(1.0);
             tile->setDivergence(1.0);
         }
+
+        seedTiles();
     }
 
     void ConvergentFilm::clearBuffers(const glm::dvec3& color)
     {
         size_t pixelCount = _frameResolution.x * _frameResolution.y;
 
-        _sampleBuffer.clear();
-        _sampleBuffer.resize(pixelCount, glm::dvec4(0));
-
-        _varianceBuffer.clear();
-        _varianceBuffer.resize(pixelCount, glm::dvec2(0));
+        _sampleBuffer.reset(pixelCount);
+        _varianceBuffer.reset(pixelCount);
+        _divergenceBuffer.assign(pixelCount, 1.0f);
 
-        _compatibilityBuffer.clear();
-        _compatibilityBuffer.resize(pixelCount, 0.0);
-
-        _divergenceBuffer.clear();
-        _divergenceBuffer.resize(pixelCount, 1.0);
-
-        _priorityBuffer.clear();
-        _priorityBuffer.resize(pixelCount, 1.0);
+        // Uniform allocation until the first prioritization
+        unsigned char sampleCount = glm::clamp(
+            (unsigned int) glm::ceil(_sampleMultiplicity),
+            1u, MAX_PIXEL_SAMPLE_COUNT);
+        for(int b=0; b < 2; ++b)
+        {
+            _priorityBuffers[b].assign(pixelCount, 1.0f);
+            _sampleCountBuffers[b].assign(pixelCount, sampleCount);
+        }
 
         _colorBuffer.clear();
         _colorBuffer.resize(pixelCount, color);
 
-        if(pixelCount != _referenceFilm.sampleBuffer.size())
+        if(hasReferenceShot())
         {
-            clearReferenceShot();
+            if(pixelCount != _referenceFilm.sampleBuffer.size())
+                clearReferenceShot();
+            else
+                _compatibilityBuffer.assign(pixelCount, 0.0f);
         }
     }
 
     void ConvergentFilm::backupAsReferenceShot()
     {
         size_t pixelCount = _sampleBuffer.size();
-        _referenceFilm.sampleBuffer.resize(pixelCount);
-        _referenceFilm.varianceBuffer.resize(pixelCount);
-        for(size_t i=0; i < pixelCount; ++i)
+
+        if(!hasReferenceShot())
         {
-            const glm::dvec4& curSamp = _sampleBuffer[i];
-            const glm::dvec2& curVar = _varianceBuffer[i];
-            const glm::dvec4& refSamp = _referenceFilm.sampleBuffer[i];
-            const glm::dvec2& refVar = _referenceFilm.varianceBuffer[i];
+            _referenceFilm.sampleBuffer = _sampleBuffer;
+            _referenceFilm.varianceBuffer = _varianceBuffer;
+            _compatibilityBuffer.assign(pixelCount, 0.0f);
+            return;
+        }
+
+        std::vector<float> compatibility(pixelCount);
+        for(size_t i=0; i < pixelCount; ++i)
+            compatibility[i] = refCompatibility(i);
 
-            double compatibility = refCompatibility(i);
+        auto mixPlane = [&compatibility, pixelCount](
+                std::vector<float>& ref, const std::vector<float>& cur)
+        {
+            const float* c = compatibility.data();
+            for(size_t i=0; i < pixelCount; ++i)
+                ref[i] = cur[i] + ref[i] * c[i];
+        };
 
-            _referenceFilm.sampleBuffer[i] = curSamp + refSamp * compatibility;
-            _referenceFilm.varianceBuffer[i] = curVar + refVar * compatibility;
-        }
+        mixPlane(_referenceFilm.sampleBuffer.r, _sampleBuffer.r);
+        mixPlane(_referenceFilm.sampleBuffer.g, _sampleBuffer.g);
+        mixPlane(_referenceFilm.sampleBuffer.b, _sampleBuffer.b);
+        mixPlane(_referenceFilm.sampleBuffer.w, _sampleBuffer.w);
+        mixPlane(_referenceFilm.varianceBuffer.sum, _varianceBuffer.sum);
+        mixPlane(_referenceFilm.varianceBuffer.weight, _varianceBuffer.weight);
     }
 
     bool ConvergentFilm::saveReferenceShot(const std::string& name) const
     {
+        if(!hasReferenceShot())
+            return false;
+
         return saveContent(name,
             _referenceFilm.sampleBuffer,
             _referenceFilm.varianceBuffer);
@@ -211,9 +271,14 @@ namespace prop3
     bool ConvergentFilm::loadReferenceShot(const std::string& name)
     {
         size_t pixelCount = _frameResolution.x * _frameResolution.y;
+
+        bool allocated = false;
         if(pixelCount != _referenceFilm.sampleBuffer.size())
         {
-            clearReferenceShot();
+            _referenceFilm.sampleBuffer.reset(pixelCount);
+            _referenceFilm.varianceBuffer.reset(pixelCount);
+            _compatibilityBuffer.assign(pixelCount, 0.0f);
+            allocated = true;
         }
 
         if(loadContent(name,
@@ -223,29 +288,29 @@ namespace prop3
             if(_colorOutput == ColorOutput::REFERENCE)
             {
                 for(int i=0; i < pixelCount; ++i)
-                    _colorBuffer[i] = sampleToColor(_referenceFilm.sampleBuffer[i]);
+                    _colorBuffer[i] = sampleToColor(_referenceFilm.sampleBuffer.get(i));
+                markFrameDirty();
             }
 
             return true;
         }
 
+        if(allocated)
+            clearReferenceShot();
+
         return false;
     }
 
     bool ConvergentFilm::clearReferenceShot()
     {
-        size_t pixelCount = _sampleBuffer.size();
-
-        _referenceFilm.sampleBuffer.clear();
-        _referenceFilm.sampleBuffer.resize(pixelCount, glm::dvec4(0));
-
-        _referenceFilm.varianceBuffer.clear();
-        _referenceFilm.varianceBuffer.resize(pixelCount, glm::dvec2(0));
+        _referenceFilm.sampleBuffer.release();
+        _referenceFilm.varianceBuffer.release();
+        std::vector<float>().swap(_compatibilityBuffer);
 
         if(_colorOutput == ColorOutput::REFERENCE)
         {
-            for(int i=0; i < pixelCount; ++i)
-                _colorBuffer[i] = sampleToColor(_referenceFilm.sampleBuffer[i]);
+            std::fill(_colorBuffer.begin(), _colorBuffer.end(), glm::vec3(0.0));
+            markFrameDirty();
         }
 
 		return true;
@@ -268,58 +333,100 @@ namespace prop3
 
     bool ConvergentFilm::saveContent(
             const std::string& name,
-            const std::vector<glm::dvec4>& samples,
-            const std::vector<glm::dvec2>& variances) const
+            const SamplePlanes& samples,
+            const VariancePlanes& variances) const
     {
-        std::ofstream film(name, std::ios_base::trunc | std::ios_base::binary);
+        RawFilmFile file;
+        if(!file.create(name, _frameResolution, _tilesResolution, _stateUid))
+            return false;
 
-        if(film.is_open())
+        // Tiles are streamed one by one, so that workers keep
+        // rendering and no copy of the whole film is made
+        std::vector<RawPixel> chunk;
+        for(const std::shared_ptr<Tile>& tile : _tiles)
         {
-            size_t pixelCount = samples.size();
-            _rawPixelPool.resize(pixelCount);
-            for(size_t p=0; p < pixelCount; ++p)
-                _rawPixelPool[p] = RawPixel(samples[p], variances[p]);
-
-            film.write((char*)_rawPixelPool.data(),
-                       sizeof(_rawPixelPool.front()) *
-                       _rawPixelPool.size());
-            film.close();
+            glm::ivec2 minCorner = tile->minCorner();
+            glm::ivec2 maxCorner = tile->maxCorner();
+
+            chunk.clear();
+            tile->lock();
+            for(int j=minCorner.y; j < maxCorner.y; ++j)
+            {
+                int index = j * _frameResolution.x + minCorner.x;
+                for(int i=minCorner.x; i < maxCorner.x; ++i, ++index)
+                    chunk.push_back(RawPixel(samples.get(index), variances.get(index)));
+            }
+            tile->unlock();
+
+            if(!file.writeTile(minCorner, chunk))
+            {
+                file.finish();
+                getLog().postMessage(new Message('E', false,
+                    "Could not write raw film " + name, "ConvergentFilm"));
+                return false;
+            }
         }
-        else
+
+        if(!file.finish())
         {
+            getLog().postMessage(new Message('E', false,
+                "Could not write raw film " + name, "ConvergentFilm"));
             return false;
         }
+
+        return true;
     }
 
     bool ConvergentFilm::loadContent(
             const std::string& name,
-            std::vector<glm::dvec4>& samples,
-            std::vector<glm::dvec2>& variances)
+            SamplePlanes& samples,
+            VariancePlanes& variances)
     {
-        std::ifstream film(name, std::ios_base::binary);
+        RawFilmFile file;
+        if(!file.open(name, _frameResolution))
+            return false;
 
-        if(film.is_open())
+        int frameWidth = _frameResolution.x;
+        size_t tileCount = file.tileCount();
+        for(size_t t=0; t < tileCount; ++t)
         {
-            size_t pixelCount = samples.size();
-            _rawPixelPool.resize(pixelCount);
-            film.read((char*)_rawPixelPool.data(),
-                      sizeof(_rawPixelPool.front()) *
-                      _rawPixelPool.size());
-            film.close();
+            glm::ivec2 minCorner, maxCorner;
+            file.tileCorners(t, minCorner, maxCorner);
 
-            for(size_t p=0; p < pixelCount; ++p)
-                _rawPixelPool[p].toRaw(samples[p], variances[p]);
+            const RawPixel* chunk = file.mapTile(t);
+            if(chunk == nullptr)
+            {
+                getLog().postMessage(new Message('E', false,
+                    "Raw film " + name + " is truncated", "ConvergentFilm"));
+                return false;
+            }
 
+            const RawPixel* pixels = chunk;
+            for(int j=minCorner.y; j < maxCorner.y; ++j)
+            {
+                int index = j * frameWidth + minCorner.x;
+                for(int i=minCorner.x; i < maxCorner.x; ++i, ++index, ++pixels)
+                {
+                    glm::dvec4 sample;
+                    glm::dvec2 variance;
+                    pixels->toRaw(sample, variance);
+                    samples.set(index, sample);
+                    variances.set(index, variance);
+                }
+            }
 
-            // Compute film divergence &
-            // output new film in specified color buffer
-            for(int p=0; p < pixelCount; ++p)
-                addSample(p, glm::dvec4(0.0));
-        }
-        else
-        {
-            return false;
+            file.unmapTile(chunk);
         }
+
+
+        // Compute film divergence &
+        // output new film in specified color buffer
+        int pixelCount = samples.size();
+        for(int p=0; p < pixelCount; ++p)
+            addSample(p, glm::dvec4(0.0));
+
+        markFrameDirty();
+        return true;
     }
 
     double ConvergentFilm::compileDivergence() const
@@ -373,7 +480,74 @@ namespace prop3
 
     void ConvergentFilm::rewindTiles()
     {
-        _nextTileId = 0;
+        std::lock_guard<std::mutex> lk(_tilesMutex);
+        seedTiles();
+    }
+
+    bool ConvergentFilm::runPendingTask()
+    {
+        return _prioritizer->prioritizeBand(*this);
+    }
+
+    double ConvergentFilm::prioritizationTime() const
+    {
+        return _prioritizer->prioritizationTime();
+    }
+
+    void ConvergentFilm::prepareScratchTile(ScratchTile& scratch, const Tile& tile) const
+    {
+        scratch.reset(tile);
+        scratch.trackVariance(_varianceWeightThreshold, _maxPixelIntensity);
+
+        int local = 0;
+        for(int j=tile.minCorner().y; j < tile.maxCorner().y; ++j)
+        {
+            int index = j * _frameResolution.x + tile.minCorner().x;
+
+            for(int i=tile.minCorner().x; i < tile.maxCorner().x; ++i, ++index, ++local)
+            {
+                scratch.setFilmSample(local, _sampleBuffer.get(index));
+            }
+        }
+    }
+
+    void ConvergentFilm::mergeScratchTile(const ScratchTile& scratch)
+    {
+        glm::ivec2 minCorner = scratch.minCorner();
+        glm::ivec2 maxCorner = scratch.maxCorner();
+        advanceSampleIndices(scratch);
+
+        int local = 0;
+        for(int j=minCorner.y; j < maxCorner.y; ++j)
+        {
+            int index = j * _frameResolution.x + minCorner.x;
+
+            for(int i=minCorner.x; i < maxCorner.x; ++i, ++index, ++local)
+            {
+                const glm::dvec4& sample = scratch.sample(local);
+                if(sample.w <= 0.0)
+                    continue;
+
+                glm::dvec4 newSample = _sampleBuffer.get(index) + sample;
+                _sampleBuffer.set(index, newSample);
+
+                // Pixels that were too light for variance tracking
+                // during the whole tile only get their color updated
+                const glm::dvec2& variance = scratch.variance(local);
+                if(variance.y > 0.0)
+                {
+                    glm::dvec2 newWeightedVar = _varianceBuffer.get(index) + variance;
+                    _varianceBuffer.set(index, newWeightedVar);
+                    refreshPixel(index, newSample, newWeightedVar);
+                }
+                else
+                {
+                    refreshPixelColor(index, newSample);
+                }
+            }
+        }
+
+        markDirty(minCorner, maxCorner);
     }
 
     bool ConvergentFilm::incomingTileAvailable() const
@@ -410,17 +584,28 @@ namespace prop3
             // Remove weight multiplicity after two complet frames
             _sampleMultiplicity = 1.0;
 
-            // Reprioritize frame's pixels
-            _prioritizer->launchPrioritization(*this);
-            _priorityThreshold = _prioritizer->priorityThreshold();
+            // Priorities workers computed during the pass are used
+            // by the next one, while workers prioritize this pass' own
+            if(_prioritizer->isPrioritizationReady())
+            {
+                _prioritizer->applyPrioritization(*this);
+                _priorityThreshold = _prioritizer->priorityThreshold();
+
+                if(_colorOutput == Film::ColorOutput::PRIORITY)
+                {
+                    _prioritizer->displayPrioritization(*this);
+                    markFrameDirty();
+                }
+            }
 
-            if(_colorOutput == Film::ColorOutput::PRIORITY)
+            if(!_prioritizer->isPrioritizationPending())
             {
-                _prioritizer->displayPrioritization(*this);
+                _prioritizer->launchPrioritization(*this);
             }
 
+            seedTiles();
+
             _cvMutex.lock();
-            _nextTileId = 0;
             ++_framePassCount;
             _newFrameCompleted = true;
             _cvMutex.unlock();
@@ -430,7 +615,7 @@ namespace prop3
 
     glm::dvec4 ConvergentFilm::pixelSample(int index) const
     {
-        return _sampleBuffer[index];
+        return _sampleBuffer.get(index);
     }
 
     double ConvergentFilm::pixelDivergence(int index) const
@@ -440,81 +625,93 @@ namespace prop3
 
     double ConvergentFilm::pixelPriority(int index) const
     {
-        return _priorityBuffer[index];
+        return frontPriorities()[index];
+    }
+
+    unsigned int ConvergentFilm::pixelSampleCount(int index) const
+    {
+        return frontSampleCounts()[index];
     }
     void ConvergentFilm::addSample(int index, const glm::dvec4& sample)
     {
-        glm::dvec4 oldSample = _sampleBuffer[index];
+        glm::dvec4 oldSample = _sampleBuffer.get(index);
         glm::dvec4 newSample = oldSample + sample;
-        _sampleBuffer[index] = newSample;
+        _sampleBuffer.set(index, newSample);
 
         double oldWeight = oldSample.w;
         if(oldWeight > _varianceWeightThreshold)
         {
-            double sampWeight = sample.w;
-            glm::dvec3 sampColor = glm::dvec3(sample);
-            if(sampWeight > 0.0)
-            {
-                sampColor = glm::min(
-                    _maxPixelIntensity,
-                    sampColor / sampWeight);
-            }
-
-            glm::dvec3 oldColor = glm::min(_maxPixelIntensity,
-                glm::dvec3(oldSample) / oldSample.w);
-            glm::dvec3 dColor = sampColor - oldColor;
-            double dMean = glm::dot(dColor, dColor) * sampWeight;
+            glm::dvec2 newWeightedVar = _varianceBuffer.get(index) +
+                ScratchTile::varianceTerm(oldSample, sample, _maxPixelIntensity);
+            _varianceBuffer.set(index, newWeightedVar);
 
-            _varianceBuffer[index] += glm::dvec2(dMean * sampWeight, sampWeight);
-            glm::dvec2 newWeightedVar = _varianceBuffer[index];
+            refreshPixel(index, newSample, newWeightedVar);
+        }
+        else
+        {
+            refreshPixelColor(index, newSample);
+        }
+    }
 
+    void ConvergentFilm::refreshPixel(
+            int index,
+            const glm::dvec4& newSample,
+            const glm::dvec2& newWeightedVar)
+    {
+        double compatibility = 0.0;
+        glm::dvec4 refSamp(0.0);
+        glm::dvec2 refVar(0.0);
+        if(hasReferenceShot())
+        {
+            refSamp = _referenceFilm.sampleBuffer.get(index);
+            refVar = _referenceFilm.varianceBuffer.get(index);
 
-            double compatibility = 0.0;
-            if(_referenceFilm.sampleBuffer[index].w > 0.0)
+            if(refSamp.w > 0.0)
             {
-                _compatibilityBuffer[index] = refCompatibility(index);
-                compatibility = _compatibilityBuffer[index];
+                compatibility = refCompatibility(index);
+                _compatibilityBuffer[index] = compatibility;
             }
+        }
 
 
-            // Mix current pixel with reference shot's own
-            const glm::dvec4& refSamp = _referenceFilm.sampleBuffer[index];
-            const glm::dvec2& refVar = _referenceFilm.varianceBuffer[index];
-            glm::dvec2 mixedVar = newWeightedVar + refVar * compatibility;
-            glm::dvec4 mixedSamp = newSample + refSamp * compatibility;
+        // Mix current pixel with reference shot's own
+        glm::dvec2 mixedVar = newWeightedVar + refVar * compatibility;
+        glm::dvec4 mixedSamp = newSample + refSamp * compatibility;
 
 
-            double newDiv = 1.0;
-            if(newSample.w >= _divergenceWeightThreshold)
-            {
-                newDiv = toDivergence(
-                    mixedSamp, mixedVar.x / mixedVar.y);
-                _divergenceBuffer[index] = newDiv;
-            }
+        double newDiv = 1.0;
+        if(newSample.w >= _divergenceWeightThreshold)
+        {
+            newDiv = toDivergence(
+                mixedSamp, mixedVar.x / mixedVar.y);
+            _divergenceBuffer[index] = newDiv;
+        }
 
-            if(_colorOutput == ColorOutput::ALBEDO)
-                _colorBuffer[index] = sampleToColor(mixedSamp);
+        if(_colorOutput == ColorOutput::ALBEDO)
+            _colorBuffer[index] = sampleToColor(mixedSamp);
 
-            else if(_colorOutput == ColorOutput::WEIGHT)
-                _colorBuffer[index] = weightToColor(newSample);
+        else if(_colorOutput == ColorOutput::WEIGHT)
+            _colorBuffer[index] = weightToColor(newSample);
 
-            else if(_colorOutput == ColorOutput::VARIANCE)
-                _colorBuffer[index] = varianceToColor(mixedVar);
+        else if(_colorOutput == ColorOutput::VARIANCE)
+            _colorBuffer[index] = varianceToColor(mixedVar);
 
-            else if(_colorOutput == ColorOutput::DIVERGENCE)
-                _colorBuffer[index] = divergenceToColor(newDiv);
+        else if(_colorOutput == ColorOutput::DIVERGENCE)
+            _colorBuffer[index] = divergenceToColor(newDiv);
 
-            else if(_colorOutput == ColorOutput::COMPATIBILITY)
-                _colorBuffer[index] = compatibilityToColor(compatibility);
-        }
-        else
-        {
-            if(_colorOutput == ColorOutput::ALBEDO)
-                _colorBuffer[index] = sampleToColor(newSample);
+        else if(_colorOutput == ColorOutput::COMPATIBILITY)
+            _colorBuffer[index] = compatibilityToColor(compatibility);
+    }
 
-            else if(_colorOutput == ColorOutput::WEIGHT)
-                _colorBuffer[index] = weightToColor(newSample);
-        }
+    void ConvergentFilm::refreshPixelColor(
+            int index,
+            const glm::dvec4& newSample)
+    {
+        if(_colorOutput == ColorOutput::ALBEDO)
+            _colorBuffer[index] = sampleToColor(newSample);
+
+        else if(_colorOutput == ColorOutput::WEIGHT)
+            _colorBuffer[index] = weightToColor(newSample);
     }
 
 
@@ -595,8 +792,11 @@ namespace prop3
 
     double ConvergentFilm::refCompatibility(unsigned int index) const
     {
-        const glm::dvec4& refSamp = _referenceFilm.sampleBuffer[index];
-        const glm::dvec4& curSamp = _sampleBuffer[index];
+        if(!hasReferenceShot())
+            return 0.0;
+
+        glm::dvec4 refSamp = _referenceFilm.sampleBuffer.get(index);
+        glm::dvec4 curSamp = _sampleBuffer.get(index);
 
         if(refSamp.w == 0 || curSamp.w <= _divergenceWeightThreshold)
             return 0.0;
@@ -2,10 +2,12 @@
 #define PROPROOM3D_CONVERGENTFILM_H
 
 #include <queue>
+#include <atomic>
 
 #include <CellarWorkbench/Misc/Distribution.h>
 
 #include "Film.h"
+#include "FilmPlanes.h"
 
 
 namespace prop3
@@ -40,6 +42,12 @@ namespace prop3
         virtual void tileCompleted(Tile& tile) override;
         virtual void rewindTiles() override;
 
+        virtual void prepareScratchTile(ScratchTile& scratch, const Tile& tile) const override;
+        virtual void mergeScratchTile(const ScratchTile& scratch) override;
+
+        virtual bool runPendingTask() override;
+        virtual double prioritizationTime() const override;
+
         virtual bool incomingTileAvailable() const override;
         virtual std::shared_ptr<TileMessage> nextIncomingTile() override;
         void addIncomingTile(const std::shared_ptr<TileMessage>& msg);
@@ -51,17 +59,29 @@ namespace prop3
         virtual void endTileReached() override;
         virtual double pixelDivergence(int index) const override;
         virtual double pixelPriority(int index) const override;
+        virtual unsigned int pixelSampleCount(int index) const override;
         virtual glm::dvec4 pixelSample(int index) const override;
         virtual void addSample(int index, const glm::dvec4& sample) override;
 
+        // Updates compatibility, divergence and displayed color of a
+        // pixel whose sample or variance changed
+        void refreshPixel(int index,
+                          const glm::dvec4& newSample,
+                          const glm::dvec2& newWeightedVar);
+        void refreshPixelColor(int index,
+                               const glm::dvec4& newSample);
+
         virtual bool saveContent(
                 const std::string& name,
-                const std::vector<glm::dvec4>& samples,
-                const std::vector<glm::dvec2>& variances) const;
+                const SamplePlanes& samples,
+                const VariancePlanes& variances) const;
         virtual bool loadContent(
                 const std::string& name,
-                std::vector<glm::dvec4>& samples,
-                std::vector<glm::dvec2>& variances);
+                SamplePlanes& samples,
+                VariancePlanes& variances);
+
+        // Converts pixels [beg, end) of the color buffer to output
+        void convertColors(ColorOutput colorOutput, int beg, int end);
 
         glm::vec3 sampleToColor(const glm::dvec4& sample) const;
         glm::vec3 weightToColor(const glm::dvec4& sample) const;
@@ -81,22 +101,40 @@ namespace prop3
         double refCompatibility(
                 unsigned int index) const;
 
+        bool hasReferenceShot() const;
+
+        const std::vector<float>& frontPriorities() const;
+        const std::vector<unsigned char>& frontSampleCounts() const;
+        std::vector<float>& backPriorities();
+        std::vector<unsigned char>& backSampleCounts();
+
+        // Publishes back buffers to workers
+        void swapPriorityBuffers();
+
 
 
         // RGB accumulation and its total weight
-        std::vector<glm::dvec4> _sampleBuffer;
+        SamplePlanes _sampleBuffer;
 
         // Variance stabilzes over time
-        std::vector<glm::dvec2> _varianceBuffer;
+        VariancePlanes _varianceBuffer;
 
-        // Aiming at reference per pixel reference film compitbility
-        std::vector<double> _compatibilityBuffer;
+        // Aiming at reference per pixel reference film compitbility.
+        // Only allocated along a reference shot.
+        std::vector<float> _compatibilityBuffer;
 
         // Divergence decreases over time
-        std::vector<double> _divergenceBuffer;
+        std::vector<float> _divergenceBuffer;
 
         // Priority stabilizes over time
-        std::vector<double> _priorityBuffer;
+        std::vector<float> _priorityBuffers[2];
+
+        // Samples allocated to each pixel for current pass
+        std::vector<unsigned char> _sampleCountBuffers[2];
+
+        // Workers read front priorities and sample counts while
+        // the prioritizer fills back ones for next pass
+        std::atomic<int> _frontBuffer;
 
         double _condifdenceRange;
         double _varianceWeightThreshold;
@@ -116,34 +154,46 @@ namespace prop3
         std::queue<std::shared_ptr<TileMessage>> _tileMsgs;
 
 
+        // Planes stay unallocated until a shot is backed up or loaded
         struct ReferenceShot
         {
-            std::vector<glm::dvec4> sampleBuffer;
-            std::vector<glm::dvec2> varianceBuffer;
+            SamplePlanes sampleBuffer;
+            VariancePlanes varianceBuffer;
         } _referenceFilm;
+    };
 
 
-        struct RawPixel
-        {
-            RawPixel();
-            RawPixel(const glm::dvec4& sample, const glm::dvec2& variance);
-            void toRaw(glm::dvec4& sample, glm::dvec2& variance) const;
-
-            float var;
-            float weight;
-            unsigned short vw;
-            unsigned short v;
-            unsigned short r;
-            unsigned short g;
-            unsigned short b;
-
-            static const double COLOR_SCALING;
-            static const double VARIANCE_SCALING;
-            static const double COLOR_DECOMPRESSION;
-            static const double VARIANCE_DECOMPRESSION;
-        };
-        mutable std::vector<RawPixel> _rawPixelPool;
-    };
+
+    // IMPLEMENTATION //
+    inline bool ConvergentFilm::hasReferenceShot() const
+    {
+        return _referenceFilm.sampleBuffer.isAllocated();
+    }
+
+    inline const std::vector<float>& ConvergentFilm::frontPriorities() const
+    {
+        return _priorityBuffers[_frontBuffer.load(std::memory_order_acquire)];
+    }
+
+    inline const std::vector<unsigned char>& ConvergentFilm::frontSampleCounts() const
+    {
+        return _sampleCountBuffers[_frontBuffer.load(std::memory_order_acquire)];
+    }
+
+    inline std::vector<float>& ConvergentFilm::backPriorities()
+    {
+        return _priorityBuffers[1 - _frontBuffer.load(std::memory_order_acquire)];
+    }
+
+    inline std::vector<unsigned char>& ConvergentFilm::backSampleCounts()
+    {
+        return _sampleCountBuffers[1 - _frontBuffer.load(std::memory_order_acquire)];
+    }
+
+    inline void ConvergentFilm::swapPriorityBuffers()
+    {
+        _frontBuffer.store(1 - _frontBuffer.load(), std::memory_order_release);
+    }
 }
 
 #endif // PROPROOM3D_CONVERGENTFILM_H
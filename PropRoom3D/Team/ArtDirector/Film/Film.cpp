@@ -2,9 +2,18 @@
 
 #include <algorithm>
 
+#include "ScratchTile.h"
+
 
 namespace prop3
 {
+    const int Film::SUBTILE_HEIGHT = 4;
+    const unsigned int Film::MAX_PIXEL_SAMPLE_COUNT = 16;
+
+    // Past this count, regions are dropped for the whole frame
+    const size_t MAX_DIRTY_REGION_COUNT = 16384;
+
+
     Film::Film() :
         _stateUid(-1),
         _framePassCount(0),
@@ -17,8 +26,9 @@ namespace prop3
         _priorityThreshold(0.0),
         _sampleMultiplicity(1.0),
         _tilesResolution(16, 16),
-        _nextTileId(0),
-        _endTile(nullptr)
+        _tilesExhausted(false),
+        _endTile(nullptr),
+        _frameDirty(true)
     {
 
     }
@@ -55,16 +65,141 @@ namespace prop3
         }
     }
 
+    void Film::setWorkerCount(size_t workerCount)
+    {
+        setWorkerNodes(std::vector<size_t>(workerCount, 0));
+    }
+
+    void Film::setWorkerNodes(const std::vector<size_t>& workerNodes)
+    {
+        std::lock_guard<std::mutex> lk(_tilesMutex);
+
+        _workerNodes = workerNodes;
+        _tileScheduler.resize(workerNodes.size(), _tiles.size());
+        assignTileNodes();
+        seedTiles();
+    }
+
     void Film::clear(const glm::dvec3 &color)
     {
         resetFilmState();
         clearBuffers(color);
+        _sampleIndexBuffer.assign(_frameResolution.x * _frameResolution.y, 0);
+        markFrameDirty();
     }
 
     void Film::clear(const std::string& filmName)
     {
         resetFilmState();
         loadRawFilm(filmName);
+        _sampleIndexBuffer.assign(_frameResolution.x * _frameResolution.y, 0);
+        markFrameDirty();
+    }
+
+    std::vector<Film::Region> Film::takeDirtyRegions()
+    {
+        std::vector<Region> regions;
+
+        {
+            std::lock_guard<std::mutex> lk(_dirtyMutex);
+            if(_frameDirty)
+            {
+                _frameDirty = false;
+                _dirtyRegions.clear();
+                regions.push_back(Region{glm::ivec2(0), _frameResolution});
+                return regions;
+            }
+
+            regions.swap(_dirtyRegions);
+        }
+
+        if(regions.empty())
+            return regions;
+
+        // Sub-tiles of a tile are stacked : merge them back into
+        // the tile, then merge neighbor tiles of a same row
+        std::sort(regions.begin(), regions.end(),
+            [](const Region& r1, const Region& r2){
+                if(r1.minCorner.x != r2.minCorner.x) return r1.minCorner.x < r2.minCorner.x;
+                if(r1.maxCorner.x != r2.maxCorner.x) return r1.maxCorner.x < r2.maxCorner.x;
+                return r1.minCorner.y < r2.minCorner.y;
+        });
+
+        size_t last = 0;
+        for(size_t r=1; r < regions.size(); ++r)
+        {
+            Region& prev = regions[last];
+            const Region& curr = regions[r];
+            if(curr.minCorner.x == prev.minCorner.x &&
+               curr.maxCorner.x == prev.maxCorner.x &&
+               curr.minCorner.y <= prev.maxCorner.y)
+                prev.maxCorner.y = glm::max(prev.maxCorner.y, curr.maxCorner.y);
+            else
+                regions[++last] = curr;
+        }
+        regions.resize(last + 1);
+
+        std::sort(regions.begin(), regions.end(),
+            [](const Region& r1, const Region& r2){
+                if(r1.minCorner.y != r2.minCorner.y) return r1.minCorner.y < r2.minCorner.y;
+                if(r1.maxCorner.y != r2.maxCorner.y) return r1.maxCorner.y < r2.maxCorner.y;
+                return r1.minCorner.x < r2.minCorner.x;
+        });
+
+        last = 0;
+        size_t dirtyArea = 0;
+        for(size_t r=1; r < regions.size(); ++r)
+        {
+            Region& prev = regions[last];
+            const Region& curr = regions[r];
+            if(curr.minCorner.y == prev.minCorner.y &&
+               curr.maxCorner.y == prev.maxCorner.y &&
+               curr.minCorner.x <= prev.maxCorner.x)
+                prev.maxCorner.x = glm::max(prev.maxCorner.x, curr.maxCorner.x);
+            else
+                regions[++last] = curr;
+        }
+        regions.resize(last + 1);
+
+        for(const Region& region : regions)
+        {
+            glm::ivec2 size = region.maxCorner - region.minCorner;
+            dirtyArea += size.x * size.y;
+        }
+
+        // One transfer beats many once most of the frame changed
+        size_t frameArea = _frameResolution.x * _frameResolution.y;
+        if(dirtyArea * 2 > frameArea)
+        {
+            regions.clear();
+            regions.push_back(Region{glm::ivec2(0), _frameResolution});
+        }
+
+        return regions;
+    }
+
+    void Film::markDirty(const glm::ivec2& minCorner, const glm::ivec2& maxCorner)
+    {
+        std::lock_guard<std::mutex> lk(_dirtyMutex);
+        if(_frameDirty)
+            return;
+
+        if(_dirtyRegions.size() < MAX_DIRTY_REGION_COUNT)
+        {
+            _dirtyRegions.push_back(Region{minCorner, maxCorner});
+        }
+        else
+        {
+            _frameDirty = true;
+            _dirtyRegions.clear();
+        }
+    }
+
+    void Film::markFrameDirty()
+    {
+        std::lock_guard<std::mutex> lk(_dirtyMutex);
+        _frameDirty = true;
+        _dirtyRegions.clear();
     }
 
     bool Film::newTileCompleted()
@@ -93,26 +228,69 @@ namespace prop3
         }
     }
 
-    std::shared_ptr<Tile> Film::nextTile()
+    std::shared_ptr<Tile> Film::nextTile(size_t workerId)
     {
-        std::lock_guard<std::mutex> lk(_tilesMutex);
-
-        while(_nextTileId < _tiles.size())
+        size_t tileId;
+        if(takeTile(workerId, tileId))
         {
-            std::shared_ptr<Tile> tile = _tiles[_nextTileId++];
+            std::shared_ptr<Tile> tile = _tiles[tileId];
+            tile->rewindSubTiles();
+            _tileScheduler.setActiveTile(workerId, tileId);
+            return tile;
+        }
 
-            if(_nextTileId >= _tiles.size())
+        // Nothing left to deal : help with the tile that has
+        // the most sub-tiles waiting to be shot
+        std::shared_ptr<Tile> busiestTile;
+        int busiestCount = 0;
+        for(size_t w=0; w < _tileScheduler.workerCount(); ++w)
+        {
+            size_t activeId = _tileScheduler.activeTile(w);
+            if(activeId < _tiles.size())
             {
-                endTileReached();
+                const std::shared_ptr<Tile>& tile = _tiles[activeId];
+                int count = tile->unclaimedSubTileCount();
+                if(count > busiestCount)
+                {
+                    busiestCount = count;
+                    busiestTile = tile;
+                }
             }
+        }
+
+        if(busiestTile.get() != nullptr)
+            return busiestTile;
+
+        return endTile();
+    }
+
+    bool Film::takeTile(size_t workerId, size_t& tileId)
+    {
+        if(_tileScheduler.take(workerId, tileId))
+        {
+            if(!_tileScheduler.isEmpty())
+                return true;
 
-            if(tile->tilePriority() >= _priorityThreshold)
+            std::lock_guard<std::mutex> lk(_tilesMutex);
+            if(!_tilesExhausted && _tileScheduler.isEmpty())
             {
-                return tile;
+                _tilesExhausted = true;
+                endTileReached();
             }
+
+            return true;
         }
 
-        return endTile();
+        // Whoever finds the deques empty first ends the pass,
+        // which may deal a new one
+        std::lock_guard<std::mutex> lk(_tilesMutex);
+        if(!_tilesExhausted && _tileScheduler.isEmpty())
+        {
+            _tilesExhausted = true;
+            endTileReached();
+        }
+
+        return _tileScheduler.take(workerId, tileId);
     }
 
     void Film::waitForFrameCompletion()
@@ -126,6 +304,54 @@ namespace prop3
         return true;
     }
 
+    bool Film::runPendingTask()
+    {
+        return false;
+    }
+
+    double Film::prioritizationTime() const
+    {
+        return 0.0;
+    }
+
+    void Film::prepareScratchTile(ScratchTile& scratch, const Tile& tile) const
+    {
+        scratch.reset(tile);
+    }
+
+    void Film::mergeScratchTile(const ScratchTile& scratch)
+    {
+        glm::ivec2 minCorner = scratch.minCorner();
+        glm::ivec2 maxCorner = scratch.maxCorner();
+        markDirty(minCorner, maxCorner);
+        advanceSampleIndices(scratch);
+
+        int local = 0;
+        for(int j=minCorner.y; j < maxCorner.y; ++j)
+        {
+            for(int i=minCorner.x; i < maxCorner.x; ++i, ++local)
+            {
+                const glm::dvec4& sample = scratch.sample(local);
+                if(sample.w > 0.0)
+                    addSample(i, j, sample);
+            }
+        }
+    }
+
+    void Film::advanceSampleIndices(const ScratchTile& scratch)
+    {
+        glm::ivec2 minCorner = scratch.minCorner();
+        glm::ivec2 maxCorner = scratch.maxCorner();
+
+        int local = 0;
+        for(int j=minCorner.y; j < maxCorner.y; ++j)
+        {
+            int index = j * _frameResolution.x + minCorner.x;
+            for(int i=minCorner.x; i < maxCorner.x; ++i, ++index, ++local)
+                _sampleIndexBuffer[index] += scratch.sampleCount(local);
+        }
+    }
+
     bool Film::incomingTileAvailable() const
     {
         return false;
@@ -179,8 +405,51 @@ namespace prop3
         });
 
         for(size_t i=0; i < tileCount; ++i)
+        {
             _tiles[i]->setTileId(i);
+            _tiles[i]->split(SUBTILE_HEIGHT);
+        }
+
+        _tileScheduler.resize(_tileScheduler.workerCount(), tileCount);
+        assignTileNodes();
+        seedTiles();
+    }
+
+    void Film::assignTileNodes()
+    {
+        size_t nodeCount = 1;
+        for(size_t node : _workerNodes)
+            nodeCount = glm::max(nodeCount, node + 1);
+
+        std::vector<size_t> tileNodes(_tiles.size(), 0);
+        for(size_t i=0; i < _tiles.size(); ++i)
+        {
+            size_t row = _tiles[i]->minCorner().y;
+            tileNodes[_tiles[i]->tileId()] =
+                glm::min(row * nodeCount / frameHeight(), nodeCount - 1);
+        }
+
+        _tileScheduler.setNodes(_workerNodes, tileNodes);
+    }
+
+    void Film::seedTiles()
+    {
+        std::vector<size_t> tileIds;
+        tileIds.reserve(_tiles.size());
+        for(size_t i=0; i < _tiles.size(); ++i)
+        {
+            if(_tiles[i]->tilePriority() >= _priorityThreshold)
+                tileIds.push_back(i);
+        }
+
+        // Ties keep center tiles first
+        std::stable_sort(tileIds.begin(), tileIds.end(),
+            [this](size_t t1, size_t t2){
+                return _tiles[t1]->tilePriority() >
+                       _tiles[t2]->tilePriority();
+        });
 
-        _nextTileId = 0;
+        _tileScheduler.seed(tileIds);
+        _tilesExhausted = false;
     }
 }
@@ -3,16 +3,19 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include <condition_variable>
 
 #include <GLM/glm.hpp>
 
 #include "Tile.h"
+#include "TileScheduler.h"
 
 
 namespace prop3
 {
     class TileMessage;
+    class ScratchTile;
 
 
     class PROP3D_EXPORT Film
@@ -20,6 +23,12 @@ namespace prop3
     public:
         enum class ColorOutput {ALBEDO, WEIGHT, DIVERGENCE, VARIANCE, PRIORITY, REFERENCE, COMPATIBILITY};
 
+        struct Region
+        {
+            glm::ivec2 minCorner;
+            glm::ivec2 maxCorner;
+        };
+
         Film();
         virtual ~Film();
 
@@ -39,11 +48,27 @@ namespace prop3
         void resizeTiles(int tilesWidth, int tilesHeight);
         virtual void resizeTiles(const glm::ivec2& resolution);
 
+        // Number of deques of the tile scheduler
+        void setWorkerCount(size_t workerCount);
+
+        // NUMA node of each worker. Each node owns a horizontal band
+        // of tiles, so that pixels keep being shot by the same node.
+        void setWorkerNodes(const std::vector<size_t>& workerNodes);
+
+        static const unsigned int MAX_PIXEL_SAMPLE_COUNT;
+
 
         const std::vector<float>& depthBuffer() const;
 
         virtual const std::vector<glm::vec3>& colorBuffer(ColorOutput colorOutput) = 0;
 
+        // Regions of the color buffer that changed since last call,
+        // with adjacent regions coalesced. A single region covers
+        // the frame when most of it changed.
+        std::vector<Region> takeDirtyRegions();
+        void markDirty(const glm::ivec2& minCorner, const glm::ivec2& maxCorner);
+        void markFrameDirty();
+
 
         virtual void clear(const glm::dvec3& color = glm::dvec3(0)) final;
         virtual void clear(const std::string& filmName) final;
@@ -64,6 +89,16 @@ namespace prop3
         double pixelPriority(int i, int j) const;
         double pixelPriority(const glm::ivec2& position) const;
 
+        // Samples to shoot in the pixel during current pass
+        unsigned int pixelSampleCount(int i, int j) const;
+        unsigned int pixelSampleCount(const glm::ivec2& position) const;
+
+        // Index of the pixel's next sample. Pixels number their
+        // samples 0, 1, 2... across passes, which low-discrepancy
+        // sequences rely on.
+        unsigned int pixelFirstSample(int i, int j) const;
+        unsigned int pixelFirstSample(const glm::ivec2& position) const;
+
         double priorityThreshold() const;
 
         double sampleMultiplicity() const;
@@ -83,7 +118,7 @@ namespace prop3
         bool newFrameCompleted();
 
         virtual std::shared_ptr<Tile> getTile(size_t id);
-        virtual std::shared_ptr<Tile> nextTile();
+        virtual std::shared_ptr<Tile> nextTile(size_t workerId);
         virtual std::shared_ptr<Tile> endTile();
 
         void waitForFrameCompletion();
@@ -91,6 +126,20 @@ namespace prop3
         virtual void tileCompleted(Tile& tile) = 0;
         virtual void rewindTiles() = 0;
 
+        // Workers accumulate a tile's samples in their scratch tile,
+        // then merge it in one pass. Tiles being merged never overlap.
+        // Callers hold the tile's lock.
+        virtual void prepareScratchTile(ScratchTile& scratch, const Tile& tile) const;
+        virtual void mergeScratchTile(const ScratchTile& scratch);
+
+        // Runs a share of the work the film hands to workers between
+        // tiles, such as prioritizing pixels. Returns false when none
+        // is left.
+        virtual bool runPendingTask();
+
+        // Seconds spent on latest pixel prioritization
+        virtual double prioritizationTime() const;
+
         virtual bool incomingTileAvailable() const;
         virtual std::shared_ptr<TileMessage> nextIncomingTile();
         virtual std::shared_ptr<TileMessage> nextOutgoingTile();
@@ -102,17 +151,37 @@ namespace prop3
         virtual void endTileReached() = 0;
         virtual double pixelDivergence(int index) const = 0;
         virtual double pixelPriority(int index) const = 0;
+        virtual unsigned int pixelSampleCount(int index) const = 0;
         virtual glm::dvec4 pixelSample(int index) const = 0;
         virtual void addSample(int index, const glm::dvec4& sample) = 0;
 
         virtual void buildTiles();
 
+        // Hands tiles' home nodes to the scheduler. Callers hold
+        // _tilesMutex, or workers are stopped.
+        void assignTileNodes();
+
+        // Takes a tile from the scheduler. Ends the pass when
+        // the last tile gets dealt.
+        bool takeTile(size_t workerId, size_t& tileId);
+
+        // Deals tiles above priority threshold to workers. Callers
+        // hold _tilesMutex, or workers are stopped.
+        virtual void seedTiles();
+
+        // Moves merged pixels' sample indices past their new samples.
+        // Merges call it with the tile's lock held.
+        void advanceSampleIndices(const ScratchTile& scratch);
+
+        static const int SUBTILE_HEIGHT;
+
         int _stateUid;
 
         size_t _framePassCount;
         glm::ivec2 _frameResolution;
         std::vector<glm::vec3> _colorBuffer;
         std::vector<float> _depthBuffer;
+        std::vector<uint32_t> _sampleIndexBuffer;
         ColorOutput _colorOutput;
 
         std::mutex _cvMutex;
@@ -122,14 +191,20 @@ namespace prop3
         double _sampleMultiplicity;
         std::mutex _tilesMutex;
         glm::ivec2 _tilesResolution;
+        std::vector<size_t> _workerNodes;
 
-        int _nextTileId;
+        TileScheduler _tileScheduler;
+        bool _tilesExhausted;
         std::shared_ptr<Tile> _endTile;
         std::vector<std::shared_ptr<Tile>> _tiles;
 
         int _tileCompletedCount;
         bool _newTileCompleted;
         bool _newFrameCompleted;
+
+        std::mutex _dirtyMutex;
+        bool _frameDirty;
+        std::vector<Region> _dirtyRegions;
     };
 
 
@@ -212,6 +287,27 @@ namespace prop3
         return pixelPriority(position.x, position.y);
     }
 
+    inline unsigned int Film::pixelSampleCount(int i, int j) const
+    {
+        int index = i + j * _frameResolution.x;
+        return pixelSampleCount(index);
+    }
+
+    inline unsigned int Film::pixelSampleCount(const glm::ivec2& position) const
+    {
+        return pixelSampleCount(position.x, position.y);
+    }
+
+    inline unsigned int Film::pixelFirstSample(int i, int j) const
+    {
+        return _sampleIndexBuffer[i + j * _frameResolution.x];
+    }
+
+    inline unsigned int Film::pixelFirstSample(const glm::ivec2& position) const
+    {
+        return pixelFirstSample(position.x, position.y);
+    }
+
     inline double Film::priorityThreshold() const
     {
         return _priorityThreshold;
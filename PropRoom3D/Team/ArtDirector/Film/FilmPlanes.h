@@ -0,0 +1,128 @@
+#ifndef PROPROOM3D_FILMPLANES_H
+#define PROPROOM3D_FILMPLANES_H
+
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+#include <PropRoom3D/libPropRoom3D_global.h>
+
+
+namespace prop3
+{
+    // Weighted RGB accumulations of a frame. Each channel is stored
+    // as its own single precision plane, so that whole frame passes
+    // run through contiguous floats. Pixels are accumulated in double
+    // precision before being stored back.
+    class PROP3D_EXPORT SamplePlanes
+    {
+    public:
+        // Planes hold no memory until reset
+        bool isAllocated() const;
+        size_t size() const;
+        void reset(size_t pixelCount);
+        void release();
+
+        glm::dvec4 get(size_t index) const;
+        void set(size_t index, const glm::dvec4& sample);
+
+        std::vector<float> r;
+        std::vector<float> g;
+        std::vector<float> b;
+        std::vector<float> w;
+    };
+
+    // Weighted sums of squared deviations, and the weight they
+    // were taken over
+    class PROP3D_EXPORT VariancePlanes
+    {
+    public:
+        bool isAllocated() const;
+        size_t size() const;
+        void reset(size_t pixelCount);
+        void release();
+
+        glm::dvec2 get(size_t index) const;
+        void set(size_t index, const glm::dvec2& variance);
+
+        std::vector<float> sum;
+        std::vector<float> weight;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline bool SamplePlanes::isAllocated() const
+    {
+        return !w.empty();
+    }
+
+    inline size_t SamplePlanes::size() const
+    {
+        return w.size();
+    }
+
+    inline void SamplePlanes::reset(size_t pixelCount)
+    {
+        r.assign(pixelCount, 0.0f);
+        g.assign(pixelCount, 0.0f);
+        b.assign(pixelCount, 0.0f);
+        w.assign(pixelCount, 0.0f);
+    }
+
+    inline void SamplePlanes::release()
+    {
+        std::vector<float>().swap(r);
+        std::vector<float>().swap(g);
+        std::vector<float>().swap(b);
+        std::vector<float>().swap(w);
+    }
+
+    inline glm::dvec4 SamplePlanes::get(size_t index) const
+    {
+        return glm::dvec4(r[index], g[index], b[index], w[index]);
+    }
+
+    inline void SamplePlanes::set(size_t index, const glm::dvec4& sample)
+    {
+        r[index] = float(sample.r);
+        g[index] = float(sample.g);
+        b[index] = float(sample.b);
+        w[index] = float(sample.w);
+    }
+
+    inline bool VariancePlanes::isAllocated() const
+    {
+        return !weight.empty();
+    }
+
+    inline size_t VariancePlanes::size() const
+    {
+        return weight.size();
+    }
+
+    inline void VariancePlanes::reset(size_t pixelCount)
+    {
+        sum.assign(pixelCount, 0.0f);
+        weight.assign(pixelCount, 0.0f);
+    }
+
+    inline void VariancePlanes::release()
+    {
+        std::vector<float>().swap(sum);
+        std::vector<float>().swap(weight);
+    }
+
+    inline glm::dvec2 VariancePlanes::get(size_t index) const
+    {
+        return glm::dvec2(sum[index], weight[index]);
+    }
+
+    inline void VariancePlanes::set(size_t index, const glm::dvec2& variance)
+    {
+        sum[index] = float(variance.x);
+        weight[index] = float(variance.y);
+    }
+}
+
+#endif // PROPROOM3D_FILMPLANES_H
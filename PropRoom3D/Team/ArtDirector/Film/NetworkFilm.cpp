@@ -30,7 +30,6 @@ namespace prop3
         _newTileCompleted = false;
         _newFrameCompleted = false;
 
-        _nextTileId = 0;
         _framePassCount = 0;
         _tileCompletedCount = 0;
         _priorityThreshold = 1.0;
@@ -39,6 +38,8 @@ namespace prop3
 
         while(!_tileMsgs.empty())
             _tileMsgs.pop();
+
+        seedTiles();
     }
 
     void NetworkFilm::clearBuffers(const glm::dvec3& color)
@@ -115,7 +116,8 @@ namespace prop3
 
     void NetworkFilm::rewindTiles()
     {
-        _nextTileId = 0;
+        std::lock_guard<std::mutex> lk(_tilesMutex);
+        seedTiles();
     }
 
     std::shared_ptr<TileMessage> NetworkFilm::nextOutgoingTile()
@@ -167,7 +169,7 @@ namespace prop3
 
     void NetworkFilm::endTileReached()
     {
-        _nextTileId = 0;
+        seedTiles();
     }
 
     double NetworkFilm::pixelDivergence(int index) const
@@ -180,6 +182,13 @@ namespace prop3
         return 1.0;
     }
 
+    unsigned int NetworkFilm::pixelSampleCount(int index) const
+    {
+        // Multiplicity grows with available bandwidth
+        return glm::clamp((unsigned int) glm::ceil(_sampleMultiplicity),
+                          1u, MAX_PIXEL_SAMPLE_COUNT);
+    }
+
     glm::dvec4 NetworkFilm::pixelSample(int index) const
     {
         return _sampleBuffer[index];
@@ -45,6 +45,7 @@ namespace prop3
         virtual void endTileReached() override;
         virtual double pixelDivergence(int index) const override;
         virtual double pixelPriority(int index) const override;
+        virtual unsigned int pixelSampleCount(int index) const override;
         virtual glm::dvec4 pixelSample(int index) const override;
         virtual void addSample(int index, const glm::dvec4& sample) override;
 
@@ -1,6 +1,6 @@
 #include "PixelPrioritizer.h"
 
-#include <chrono>
+#include <map>
 
 #include <CellarWorkbench/Misc/Log.h>
 
@@ -12,7 +12,11 @@ using namespace cellar;
 namespace prop3
 {
     PixelPrioritizer::PixelPrioritizer() :
-        _frameAvrgPriority(1.0)
+        _frameAvrgPriority(1.0),
+        _launched(false),
+        _nextBand(0),
+        _pendingBands(0),
+        _prioritizationTime(0.0)
     {
 
     }
@@ -22,120 +26,248 @@ namespace prop3
 
     }
 
-    void PixelPrioritizer::reset(const glm::ivec2& frameResolution)
+    void PixelPrioritizer::reset(const glm::ivec2&)
     {
         _frameAvrgPriority = 1.0;
 
-        unsigned int pixelCount =
-                frameResolution.x *
-                frameResolution.y;
-        if(pixelCount != _varBuff.size())
-        {
-            _varBuff.resize(pixelCount);
-            _tmpBuff.resize(pixelCount);
-        }
+        // Workers are stopped : bands left are dropped
+        _launched = false;
+        _nextBand.store(int(_bands.size()));
+        _pendingBands.store(0);
     }
 
     void PixelPrioritizer::launchPrioritization(ConvergentFilm& film)
     {
-//        using std::chrono::high_resolution_clock;
-//        auto tStart = high_resolution_clock::now();
-
-        std::vector<glm::dvec4>& refSampBuff = film._referenceFilm.sampleBuffer;
-        std::vector<glm::dvec4>& rawSampBuff = film._sampleBuffer;
-        std::vector<glm::dvec2>& rawVarBuff = film._varianceBuffer;
-        std::vector<double>& prioBuff = film._priorityBuffer;
-        glm::ivec2 frameResolution = film.frameResolution();
-        size_t pixelCount = rawSampBuff.size();
+        // Bands follow rows of tiles, so that each
+        // tile's priority is reduced by a single band
+        std::map<int, int> bandMaxY;
+        for(const std::shared_ptr<Tile>& tile : film._tiles)
+        {
+            int& maxY = bandMaxY[tile->minCorner().y];
+            maxY = glm::max(maxY, tile->maxCorner().y);
+        }
 
-        for(size_t p=0; p < pixelCount; ++p)
+        _bands.resize(bandMaxY.size());
+        std::map<int, size_t> bandIds;
+        for(const auto& minMax : bandMaxY)
         {
-            if(rawVarBuff[p].y > 0.0)
-                _varBuff[p] = rawVarBuff[p].x / rawVarBuff[p].y;
-            else
-                _varBuff[p] = 1.0;
+            size_t b = bandIds.size();
+            bandIds[minMax.first] = b;
+            _bands[b].minY = minMax.first;
+            _bands[b].maxY = minMax.second;
+            _bands[b].tiles.clear();
+            _bands[b].marginTiles.clear();
         }
 
-        for(int j=0; j<frameResolution.y; ++j)
+        const int KERNEL_RADIUS = KERNEL_WIDTH / 2;
+        for(size_t t=0; t < film._tiles.size(); ++t)
         {
-            unsigned int lineBaseIdx = j*frameResolution.x;
+            const Tile& tile = *film._tiles[t];
+            _bands[bandIds[tile.minCorner().y]].tiles.push_back(t);
 
-            for(int i=0; i<frameResolution.x; ++i)
+            for(Band& band : _bands)
             {
-                unsigned int idx = lineBaseIdx + i;
+                if(tile.minCorner().y < band.maxY + KERNEL_RADIUS &&
+                   tile.maxCorner().y > band.minY - KERNEL_RADIUS)
+                    band.marginTiles.push_back(t);
+            }
+        }
 
-                _tmpBuff[idx] = _varBuff[idx];
+        _tilePriorities.resize(film._tiles.size());
 
-                if(i - 1 >= 0)
-                {
-                    _tmpBuff[idx] += _varBuff[idx-1];
+        _launched = true;
+        _launchTime = std::chrono::steady_clock::now();
+        _pendingBands.store(int(_bands.size()));
+        _nextBand.store(0);
+    }
 
-                    if(i - 2 >= 0)
-                    {
-                        _tmpBuff[idx] += _varBuff[idx-2];
-                    }
-                }
+    bool PixelPrioritizer::prioritizeBand(ConvergentFilm& film)
+    {
+        if(_nextBand.load() >= int(_bands.size()))
+            return false;
+
+        int b = _nextBand.fetch_add(1);
+        if(b >= int(_bands.size()))
+            return false;
+
+        processBand(film, _bands[b]);
+
+        if(_pendingBands.fetch_sub(1) == 1)
+        {
+            std::chrono::duration<double> dt =
+                std::chrono::steady_clock::now() - _launchTime;
+            _prioritizationTime.store(dt.count());
+        }
+
+        return true;
+    }
+
+    bool PixelPrioritizer::isPrioritizationReady() const
+    {
+        return _launched && _pendingBands.load() == 0;
+    }
+
+    bool PixelPrioritizer::isPrioritizationPending() const
+    {
+        return _launched && _pendingBands.load() != 0;
+    }
 
-                if(i + 1 < frameResolution.x)
+    void PixelPrioritizer::applyPrioritization(ConvergentFilm& film)
+    {
+        double prioritySum = 0.0;
+        for(const Band& band : _bands)
+            prioritySum += band.prioritySum;
+
+        for(size_t t=0; t < _tilePriorities.size(); ++t)
+            film._tiles[t]->setTilePriority(_tilePriorities[t]);
+
+        size_t pixelCount = film.backPriorities().size();
+        _frameAvrgPriority = glm::sqrt(prioritySum / pixelCount);
+
+        // Workers still shooting previous pass' tiles keep
+        // reading front buffers until they are swapped
+        allocateSamples(film);
+        film.swapPriorityBuffers();
+
+        _launched = false;
+    }
+
+    void PixelPrioritizer::processBand(ConvergentFilm& film, Band& band)
+    {
+        const int KERNEL_RADIUS = KERNEL_WIDTH / 2;
+        const double KERNEL_AREA = KERNEL_WIDTH * KERNEL_WIDTH;
+
+        const SamplePlanes& refSampBuff = film._referenceFilm.sampleBuffer;
+        const SamplePlanes& rawSampBuff = film._sampleBuffer;
+        const VariancePlanes& rawVarBuff = film._varianceBuffer;
+        bool hasReference = film.hasReferenceShot();
+
+        int width = film._frameResolution.x;
+        int height = film._frameResolution.y;
+        int marginMinY = glm::max(band.minY - KERNEL_RADIUS, 0);
+        int marginMaxY = glm::min(band.maxY + KERNEL_RADIUS, height);
+
+        band.variances.resize((marginMaxY - marginMinY) * width);
+        band.samples.resize((band.maxY - band.minY) * width);
+        band.rowSums.resize(band.variances.size());
+        band.columnSums.assign(width, 0.0);
+
+        // Workers of next pass are merging samples meanwhile : pixels
+        // are copied under their tile's lock, one tile at a time
+        for(size_t t : band.marginTiles)
+        {
+            Tile& tile = *film._tiles[t];
+            int minX = tile.minCorner().x;
+            int maxX = tile.maxCorner().x;
+            int minY = glm::max(tile.minCorner().y, marginMinY);
+            int maxY = glm::min(tile.maxCorner().y, marginMaxY);
+
+            tile.lock();
+            for(int j=minY; j < maxY; ++j)
+            {
+                const float* varSum = &rawVarBuff.sum[j * width];
+                const float* varWeight = &rawVarBuff.weight[j * width];
+                double* var = &band.variances[(j - marginMinY) * width];
+
+                for(int i=minX; i < maxX; ++i)
                 {
-                    _tmpBuff[idx] += _varBuff[idx+1];
+                    var[i] = varWeight[i] > 0.0f ?
+                        double(varSum[i]) / varWeight[i] : 1.0;
+                }
+
+                if(j < band.minY || j >= band.maxY)
+                    continue;
 
-                    if(i + 2 < frameResolution.x)
+                glm::dvec4* samples = &band.samples[(j - band.minY) * width];
+                for(int i=minX; i < maxX; ++i)
+                {
+                    unsigned int idx = j * width + i;
+                    samples[i] = rawSampBuff.get(idx);
+                    if(hasReference)
                     {
-                        _tmpBuff[idx] += _varBuff[idx+2];
+                        double compatibility = film._compatibilityBuffer[idx];
+                        samples[i] += refSampBuff.get(idx) * compatibility;
                     }
                 }
             }
+            tile.unlock();
         }
 
-        for(int j=0; j<frameResolution.y; ++j)
+        // Horizontal box sums of variances,
+        // using a sliding window along each row
+        for(int j=marginMinY; j < marginMaxY; ++j)
         {
-            unsigned int lineBaseIdx = j*frameResolution.x;
+            const double* var = &band.variances[(j - marginMinY) * width];
+            double* rowSum = &band.rowSums[(j - marginMinY) * width];
+
+            double window = 0.0;
+            for(int i=0; i <= KERNEL_RADIUS && i < width; ++i)
+                window += var[i];
 
-            for(int i=0; i<frameResolution.x; ++i)
+            for(int i=0; i < width; ++i)
             {
-                unsigned int idx = lineBaseIdx + i;
+                rowSum[i] = window;
 
-                double meanVar = _tmpBuff[idx];
+                if(i + KERNEL_RADIUS + 1 < width)
+                    window += var[i + KERNEL_RADIUS + 1];
+                if(i - KERNEL_RADIUS >= 0)
+                    window -= var[i - KERNEL_RADIUS];
+            }
+        }
 
-                if(j - 1 >= 0)
-                {
-                    meanVar += _tmpBuff[idx-frameResolution.x];
+        // Vertical box sums slide down the band a whole row at a time
+        double* columnSum = band.columnSums.data();
+        int firstRowEnd = glm::min(band.minY + KERNEL_RADIUS + 1, marginMaxY);
+        for(int j=marginMinY; j < firstRowEnd; ++j)
+        {
+            const double* rowSum = &band.rowSums[(j - marginMinY) * width];
+            for(int i=0; i < width; ++i)
+                columnSum[i] += rowSum[i];
+        }
 
-                    if(j - 2 >= 0)
-                    {
-                        meanVar += _tmpBuff[idx-2*frameResolution.x];
-                    }
-                }
+        float* prioBuff = film.backPriorities().data();
+        for(int j=band.minY; j < band.maxY; ++j)
+        {
+            const double* var = &band.variances[(j - marginMinY) * width];
+            const glm::dvec4* samples = &band.samples[(j - band.minY) * width];
+            unsigned int lineBaseIdx = j * width;
 
-                if(j + 1 < frameResolution.y)
-                {
-                    meanVar += _tmpBuff[idx+frameResolution.x];
+            for(int i=0; i < width; ++i)
+            {
+                unsigned int idx = lineBaseIdx + i;
 
-                    if(j + 2 < frameResolution.y)
-                    {
-                        meanVar += _tmpBuff[idx+2*frameResolution.x];
-                    }
-                }
+                double meanVar = glm::max(columnSum[i] / KERNEL_AREA, var[i]);
+                prioBuff[idx] = film.toPriority(samples[i], meanVar);
+            }
 
-                double var = glm::max(meanVar / 25.0, _varBuff[idx]);
-                double compatibility = film._compatibilityBuffer[idx];
-                glm::dvec4 mixedSample = rawSampBuff[idx] +
-                        refSampBuff[idx] * compatibility;
+            if(j + KERNEL_RADIUS + 1 < marginMaxY)
+            {
+                const double* rowSum = &band.rowSums[
+                    (j + KERNEL_RADIUS + 1 - marginMinY) * width];
+                for(int i=0; i < width; ++i)
+                    columnSum[i] += rowSum[i];
+            }
 
-                prioBuff[idx] = film.toPriority(mixedSample, var);
+            if(j - KERNEL_RADIUS >= marginMinY)
+            {
+                const double* rowSum = &band.rowSums[
+                    (j - KERNEL_RADIUS - marginMinY) * width];
+                for(int i=0; i < width; ++i)
+                    columnSum[i] -= rowSum[i];
             }
         }
 
-        _frameAvrgPriority = 0.0;
-        for(const std::shared_ptr<Tile>& tile : film._tiles)
+        band.prioritySum = 0.0;
+        for(size_t t : band.tiles)
         {
+            const Tile& tile = *film._tiles[t];
+
             double tileMaxPriority = 0.0;
-            for(int j=tile->minCorner().y; j < tile->maxCorner().y; ++j)
+            for(int j=tile.minCorner().y; j < tile.maxCorner().y; ++j)
             {
                 double tilePrioSum = 0.0;
-                int index = j * frameResolution.x + tile->minCorner().x;
-                for(int i=tile->minCorner().x; i < tile->maxCorner().x; ++i, ++index)
+                int index = j * width + tile.minCorner().x;
+                for(int i=tile.minCorner().x; i < tile.maxCorner().x; ++i, ++index)
                 {
                     tilePrioSum += prioBuff[index] * prioBuff[index];
 
@@ -143,20 +275,47 @@ namespace prop3
                         tileMaxPriority = prioBuff[index];
                 }
 
-                _frameAvrgPriority += tilePrioSum;
+                band.prioritySum += tilePrioSum;
             }
 
-            tile->setTilePriority(tileMaxPriority);
+            _tilePriorities[t] = tileMaxPriority;
         }
+    }
 
-        _frameAvrgPriority = glm::sqrt(_frameAvrgPriority / pixelCount);
+    void PixelPrioritizer::allocateSamples(
+            ConvergentFilm& film)
+    {
+        const std::vector<float>& prioBuff = film.backPriorities();
+        std::vector<unsigned char>& countBuff = film.backSampleCounts();
+        size_t pixelCount = prioBuff.size();
+
+        // Priorities follow pixels' standard deviation : samples are
+        // allocated in proportion, relative to the frame's threshold.
+        double threshold = priorityThreshold();
+        double scale = 0.0;
+        if(threshold > 0.0)
+            scale = film.sampleMultiplicity() / threshold;
+
+        // Rounding remainders are carried over to the next pixel
+        // so that the pass' total budget is preserved. Samples cut
+        // by the per pixel maximum are carried over too, and the
+        // minimum of one sample is charged to the carry.
+        double carry = 0.0;
+        for(size_t p=0; p < pixelCount; ++p)
+        {
+            if(prioBuff[p] < threshold)
+            {
+                countBuff[p] = 0;
+                continue;
+            }
+
+            carry += prioBuff[p] * scale;
+            double count = glm::clamp(glm::floor(carry), 1.0,
+                double(Film::MAX_PIXEL_SAMPLE_COUNT));
+            carry -= count;
 
-//        auto tEnd = high_resolution_clock::now();
-//        float us = (tEnd - tStart).count() / 1.0e3;
-//        getLog().postMessage(new Message('I', false,
-//            "Pixel Prioritization time (us) :\t " +
-//                std::to_string(us),
-//            "PixelPrioritizer"));
+            countBuff[p] = count;
+        }
     }
 
     void PixelPrioritizer::displayPrioritization(
@@ -166,11 +325,12 @@ namespace prop3
                 film._frameResolution.x *
                 film._frameResolution.y;
 
+        const std::vector<float>& prioBuff = film.frontPriorities();
         for(int i=0; i < pixelCount; ++i)
         {
             film._colorBuffer[i] =
                 film.priorityToColor(
-                    film._priorityBuffer[i]);
+                    prioBuff[i]);
         }
     }
 
@@ -183,4 +343,9 @@ namespace prop3
     {
         return glm::min(_frameAvrgPriority, 1.0);
     }
+
+    double PixelPrioritizer::prioritizationTime() const
+    {
+        return _prioritizationTime.load();
+    }
 }
@@ -1,6 +1,9 @@
 #ifndef PROPROOM3D_PIXELPRIORITIZER_H
 #define PROPROOM3D_PIXELPRIORITIZER_H
 
+#include <atomic>
+#include <chrono>
+
 #include "Film.h"
 
 
@@ -8,6 +11,13 @@ namespace prop3
 {
     class ConvergentFilm;
 
+    // Prioritization of a frame is split in row bands, one per row of
+    // tiles, that workers process between their tiles. Priorities are
+    // computed in film's back buffers while the next pass renders with
+    // the front ones, and swapped in at the end of that pass. Pixels
+    // are thus shot with priorities that lag one pass behind.
+    // Bands copy pixels under their tiles' lock, since workers keep
+    // merging samples while they are prioritized.
     class PROP3D_EXPORT PixelPrioritizer
     {
     public:
@@ -16,21 +26,73 @@ namespace prop3
 
         virtual void reset(const glm::ivec2& frameResolution);
 
+        // Deals bands of the frame to workers. Callers hold
+        // film's tiles mutex.
         virtual void launchPrioritization(
                 ConvergentFilm& film);
 
+        // Processes a band of the launched prioritization.
+        // Returns false when no band is left.
+        virtual bool prioritizeBand(
+                ConvergentFilm& film);
+
+        // True once every band of the launched prioritization is done
+        virtual bool isPrioritizationReady() const;
+        virtual bool isPrioritizationPending() const;
+
+        // Swaps computed priorities in and allocates next pass'
+        // samples. Callers hold film's tiles mutex.
+        virtual void applyPrioritization(
+                ConvergentFilm& film);
+
         virtual void displayPrioritization(
                 ConvergentFilm& film);
 
         virtual double averagePriority() const;
         virtual double priorityThreshold() const;
 
+        // Seconds from launch to last band of latest prioritization
+        virtual double prioritizationTime() const;
+
         static const int KERNEL_WIDTH = 5;
 
+    protected:
+        // Converts priorities into sample counts for next pass
+        virtual void allocateSamples(
+                ConvergentFilm& film);
+
     private:
-        std::vector<double> _varBuff;
-        std::vector<double> _tmpBuff;
+        struct Band
+        {
+            int minY;
+            int maxY;
+            std::vector<size_t> tiles;
+            double prioritySum;
+
+            // Tiles covering the band and its kernel's margin
+            std::vector<size_t> marginTiles;
+
+            // Pixels copied from the film. Variances include
+            // kernel's margin, samples are mixed with reference.
+            std::vector<double> variances;
+            std::vector<glm::dvec4> samples;
+            std::vector<double> rowSums;
+            std::vector<double> columnSums;
+        };
+
+        void processBand(
+                ConvergentFilm& film,
+                Band& band);
+
+        std::vector<Band> _bands;
+        std::vector<double> _tilePriorities;
         double _frameAvrgPriority;
+
+        bool _launched;
+        std::atomic<int> _nextBand;
+        std::atomic<int> _pendingBands;
+        std::chrono::steady_clock::time_point _launchTime;
+        std::atomic<double> _prioritizationTime;
     };
 }
 
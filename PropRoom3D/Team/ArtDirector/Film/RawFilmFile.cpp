@@ -0,0 +1,247 @@
+#include "RawFilmFile.h"
+
+#include <limits>
+#include <cstring>
+
+#include <CellarWorkbench/Misc/Log.h>
+
+using namespace cellar;
+
+
+namespace prop3
+{
+    const double UINT_MAX_DOUBLE = std::numeric_limits<unsigned short>::max();
+    const double RawPixel::COLOR_SCALING = 1 / 8.0;
+    const double RawPixel::VARIANCE_SCALING = 1 / 16.0;
+    const double RawPixel::COLOR_DECOMPRESSION = 8.0 / UINT_MAX_DOUBLE;
+    const double RawPixel::VARIANCE_DECOMPRESSION = 16.0 / UINT_MAX_DOUBLE;
+
+    RawPixel::RawPixel() :
+        weight(0.0), v(0), r(0), g(0), b(0)
+    {
+
+    }
+
+    RawPixel::RawPixel(
+            const glm::dvec4& sample,
+            const glm::dvec2& variance)
+    {
+        var = variance.x;
+        weight = sample.w;
+        double weightInv = 1 / weight;
+        vw = glm::min((weight - variance.y) * VARIANCE_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
+        r = glm::min(glm::sqrt(sample.r * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
+        g = glm::min(glm::sqrt(sample.g * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
+        b = glm::min(glm::sqrt(sample.b * weightInv) * COLOR_SCALING, 1.0) * std::numeric_limits<unsigned short>::max();
+    }
+
+    void RawPixel::toRaw(
+            glm::dvec4& sample,
+            glm::dvec2& variance) const
+    {
+        variance.x = var;
+        sample.w = weight;
+        variance.y = weight - vw * VARIANCE_DECOMPRESSION;
+        sample.r = r * COLOR_DECOMPRESSION;
+        sample.r = weight * (sample.r * sample.r);
+        sample.g = g * COLOR_DECOMPRESSION;
+        sample.g = weight * (sample.g * sample.g);
+        sample.b = b * COLOR_DECOMPRESSION;
+        sample.b = weight * (sample.b * sample.b);
+    }
+
+
+    const char RawFilmFile::MAGIC[8] = {'P', '3', 'D', 'F', 'I', 'L', 'M', '\0'};
+    const uint32_t RawFilmFile::VERSION = 1;
+
+    RawFilmFile::RawFilmFile() :
+        _columnCount(0),
+        _writeOffset(0)
+    {
+        std::memset(&_header, 0, sizeof(_header));
+    }
+
+    RawFilmFile::~RawFilmFile()
+    {
+
+    }
+
+    bool RawFilmFile::create(
+            const std::string& name,
+            const glm::ivec2& frameResolution,
+            const glm::ivec2& tileResolution,
+            int stateUid)
+    {
+        _file.setFileName(name.c_str());
+        if(!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+
+        _columnCount = (frameResolution.x + tileResolution.x - 1) / tileResolution.x;
+        int rowCount = (frameResolution.y + tileResolution.y - 1) / tileResolution.y;
+
+        std::memcpy(_header.magic, MAGIC, sizeof(MAGIC));
+        _header.version = VERSION;
+        _header.pixelSize = sizeof(RawPixel);
+        _header.frameWidth = frameResolution.x;
+        _header.frameHeight = frameResolution.y;
+        _header.tileWidth = tileResolution.x;
+        _header.tileHeight = tileResolution.y;
+        _header.stateUid = stateUid;
+        _header.tileCount = _columnCount * rowCount;
+
+        // Table is filled as chunks get written
+        _chunkOffsets.assign(_header.tileCount, 0);
+        qint64 tableSize = sizeof(uint64_t) * _chunkOffsets.size();
+
+        if(_file.write((const char*)&_header, sizeof(_header)) != sizeof(_header) ||
+           _file.write((const char*)_chunkOffsets.data(), tableSize) != tableSize)
+        {
+            _file.close();
+            return false;
+        }
+
+        _writeOffset = sizeof(_header) + tableSize;
+        return true;
+    }
+
+    bool RawFilmFile::writeTile(
+            const glm::ivec2& minCorner,
+            const std::vector<RawPixel>& pixels)
+    {
+        size_t tile = tileIndex(minCorner);
+        if(tile >= _chunkOffsets.size())
+            return false;
+
+        qint64 chunkSize = sizeof(RawPixel) * pixels.size();
+        if(_file.write((const char*)pixels.data(), chunkSize) != chunkSize)
+            return false;
+
+        _chunkOffsets[tile] = _writeOffset;
+        _writeOffset += chunkSize;
+        return true;
+    }
+
+    bool RawFilmFile::finish()
+    {
+        qint64 tableSize = sizeof(uint64_t) * _chunkOffsets.size();
+
+        bool ok = _file.seek(sizeof(_header)) &&
+            _file.write((const char*)_chunkOffsets.data(), tableSize) == tableSize;
+
+        _file.close();
+        return ok;
+    }
+
+    bool RawFilmFile::open(
+            const std::string& name,
+            const glm::ivec2& frameResolution)
+    {
+        _file.setFileName(name.c_str());
+        if(!_file.open(QIODevice::ReadOnly))
+            return false;
+
+        qint64 fileSize = _file.size();
+        qint64 legacySize = qint64(sizeof(RawPixel)) *
+            frameResolution.x * frameResolution.y;
+
+        if(_file.read((char*)&_header, sizeof(_header)) != sizeof(_header) ||
+           std::memcmp(_header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            if(fileSize != legacySize)
+            {
+                getLog().postMessage(new Message('E', false,
+                    name + " is not a raw film", "RawFilmFile"));
+                _file.close();
+                return false;
+            }
+
+            std::memcpy(_header.magic, MAGIC, sizeof(MAGIC));
+            _header.version = 0;
+            _header.pixelSize = sizeof(RawPixel);
+            _header.frameWidth = frameResolution.x;
+            _header.frameHeight = frameResolution.y;
+            _header.tileWidth = frameResolution.x;
+            _header.tileHeight = frameResolution.y;
+            _header.stateUid = 0;
+            _header.tileCount = 1;
+            _columnCount = 1;
+            _chunkOffsets.assign(1, 0);
+            return true;
+        }
+
+        if(_header.version != VERSION || _header.pixelSize != sizeof(RawPixel))
+        {
+            getLog().postMessage(new Message('E', false,
+                name + " raw film version (" + std::to_string(_header.version) +
+                ") is not supported", "RawFilmFile"));
+            _file.close();
+            return false;
+        }
+
+        if(_header.frameWidth != frameResolution.x ||
+           _header.frameHeight != frameResolution.y ||
+           _header.tileWidth <= 0 || _header.tileHeight <= 0)
+        {
+            getLog().postMessage(new Message('E', false,
+                name + " raw film resolution (" +
+                std::to_string(_header.frameWidth) + "x" +
+                std::to_string(_header.frameHeight) +
+                ") does not match frame's", "RawFilmFile"));
+            _file.close();
+            return false;
+        }
+
+        _columnCount = (_header.frameWidth + _header.tileWidth - 1) / _header.tileWidth;
+        int rowCount = (_header.frameHeight + _header.tileHeight - 1) / _header.tileHeight;
+        if(_header.tileCount != uint32_t(_columnCount * rowCount))
+        {
+            _file.close();
+            return false;
+        }
+
+        _chunkOffsets.resize(_header.tileCount);
+        qint64 tableSize = sizeof(uint64_t) * _chunkOffsets.size();
+        if(_file.read((char*)_chunkOffsets.data(), tableSize) != tableSize)
+        {
+            _file.close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void RawFilmFile::tileCorners(
+            size_t tile,
+            glm::ivec2& minCorner,
+            glm::ivec2& maxCorner) const
+    {
+        glm::ivec2 tileResolution(_header.tileWidth, _header.tileHeight);
+        glm::ivec2 frameResolution(_header.frameWidth, _header.frameHeight);
+
+        minCorner = glm::ivec2(tile % _columnCount, tile / _columnCount) * tileResolution;
+        maxCorner = glm::min(minCorner + tileResolution, frameResolution);
+    }
+
+    const RawPixel* RawFilmFile::mapTile(size_t tile)
+    {
+        glm::ivec2 minCorner, maxCorner;
+        tileCorners(tile, minCorner, maxCorner);
+        glm::ivec2 tileDim = maxCorner - minCorner;
+
+        // Chunks of current version never start at file's begining
+        qint64 offset = _chunkOffsets[tile];
+        if(offset == 0 && _header.version != 0)
+            return nullptr;
+
+        qint64 chunkSize = qint64(sizeof(RawPixel)) * tileDim.x * tileDim.y;
+        if(offset + chunkSize > _file.size())
+            return nullptr;
+
+        return (const RawPixel*) _file.map(offset, chunkSize);
+    }
+
+    void RawFilmFile::unmapTile(const RawPixel* pixels)
+    {
+        _file.unmap((uchar*) pixels);
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef PROPROOM3D_RAWFILMFILE_H
+#define PROPROOM3D_RAWFILMFILE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <GLM/glm.hpp>
+
+#include <QFile>
+
+#include <PropRoom3D/libPropRoom3D_global.h>
+
+
+namespace prop3
+{
+    // Compressed pixel of a raw film
+    struct PROP3D_EXPORT RawPixel
+    {
+        RawPixel();
+        RawPixel(const glm::dvec4& sample, const glm::dvec2& variance);
+        void toRaw(glm::dvec4& sample, glm::dvec2& variance) const;
+
+        float var;
+        float weight;
+        unsigned short vw;
+        unsigned short v;
+        unsigned short r;
+        unsigned short g;
+        unsigned short b;
+
+        static const double COLOR_SCALING;
+        static const double VARIANCE_SCALING;
+        static const double COLOR_DECOMPRESSION;
+        static const double VARIANCE_DECOMPRESSION;
+    };
+
+
+    // Raw films are a header, a table of chunk offsets and one chunk
+    // of pixels per tile. Tiles are numbered row by row and a chunk
+    // holds its tile's pixels row by row. Chunks are written in any
+    // order, and mapped one at a time when read.
+    class PROP3D_EXPORT RawFilmFile
+    {
+    public:
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t pixelSize;
+            int32_t frameWidth;
+            int32_t frameHeight;
+            int32_t tileWidth;
+            int32_t tileHeight;
+            int32_t stateUid;
+            uint32_t tileCount;
+        };
+
+        static const char MAGIC[8];
+        static const uint32_t VERSION;
+
+        RawFilmFile();
+        ~RawFilmFile();
+
+        // Writing
+        bool create(const std::string& name,
+                    const glm::ivec2& frameResolution,
+                    const glm::ivec2& tileResolution,
+                    int stateUid);
+
+        // Pixels of the tile starting at min corner
+        bool writeTile(const glm::ivec2& minCorner,
+                       const std::vector<RawPixel>& pixels);
+
+        // Writes chunk table and closes file
+        bool finish();
+
+
+        // Reading. Headerless films of previous versions are read
+        // as a single tile when they match frame resolution.
+        bool open(const std::string& name,
+                  const glm::ivec2& frameResolution);
+
+        const Header& header() const;
+        size_t tileCount() const;
+        void tileCorners(size_t tile,
+                         glm::ivec2& minCorner,
+                         glm::ivec2& maxCorner) const;
+
+        // Pixels stay mapped until unmapTile is called
+        const RawPixel* mapTile(size_t tile);
+        void unmapTile(const RawPixel* pixels);
+
+
+    private:
+        size_t tileIndex(const glm::ivec2& minCorner) const;
+
+        QFile _file;
+        Header _header;
+        int _columnCount;
+        std::vector<uint64_t> _chunkOffsets;
+        uint64_t _writeOffset;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline const RawFilmFile::Header& RawFilmFile::header() const
+    {
+        return _header;
+    }
+
+    inline size_t RawFilmFile::tileCount() const
+    {
+        return _chunkOffsets.size();
+    }
+
+    inline size_t RawFilmFile::tileIndex(const glm::ivec2& minCorner) const
+    {
+        return (minCorner.y / _header.tileHeight) * _columnCount +
+               (minCorner.x / _header.tileWidth);
+    }
+}
+
+#endif // PROPROOM3D_RAWFILMFILE_H
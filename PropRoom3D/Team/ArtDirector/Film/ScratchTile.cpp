@@ -0,0 +1,66 @@
+#include "ScratchTile.h"
+
+#include "Tile.h"
+
+
+namespace prop3
+{
+    ScratchTile::ScratchTile() :
+        _minCorner(0, 0),
+        _maxCorner(0, 0),
+        _width(0),
+        _tracksVariance(false),
+        _varianceWeightThreshold(0.0),
+        _maxPixelIntensity(1.0)
+    {
+
+    }
+
+    void ScratchTile::reset(const Tile& tile)
+    {
+        _minCorner = tile.minCorner();
+        _maxCorner = tile.maxCorner();
+        _width = _maxCorner.x - _minCorner.x;
+        _tracksVariance = false;
+
+        glm::ivec2 tileDim = _maxCorner - _minCorner;
+        size_t pixelCount = tileDim.x * tileDim.y;
+
+        // Capacity is kept from tile to tile
+        _samples.assign(pixelCount, glm::dvec4(0.0));
+        _variances.assign(pixelCount, glm::dvec2(0.0));
+        _sampleCounts.assign(pixelCount, 0);
+    }
+
+    void ScratchTile::trackVariance(
+            double weightThreshold,
+            const glm::dvec3& maxPixelIntensity)
+    {
+        _tracksVariance = true;
+        _varianceWeightThreshold = weightThreshold;
+        _maxPixelIntensity = maxPixelIntensity;
+        _filmSamples.assign(_samples.size(), glm::dvec4(0.0));
+    }
+
+    glm::dvec2 ScratchTile::varianceTerm(
+            const glm::dvec4& pixelSample,
+            const glm::dvec4& sample,
+            const glm::dvec3& maxPixelIntensity)
+    {
+        double sampWeight = sample.w;
+        glm::dvec3 sampColor = glm::dvec3(sample);
+        if(sampWeight > 0.0)
+        {
+            sampColor = glm::min(
+                maxPixelIntensity,
+                sampColor / sampWeight);
+        }
+
+        glm::dvec3 oldColor = glm::min(maxPixelIntensity,
+            glm::dvec3(pixelSample) / pixelSample.w);
+        glm::dvec3 dColor = sampColor - oldColor;
+        double dMean = glm::dot(dColor, dColor) * sampWeight;
+
+        return glm::dvec2(dMean * sampWeight, sampWeight);
+    }
+}
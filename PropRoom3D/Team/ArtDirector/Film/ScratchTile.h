@@ -0,0 +1,131 @@
+#ifndef PROPROOM3D_SCRATCHTILE_H
+#define PROPROOM3D_SCRATCHTILE_H
+
+#include <vector>
+
+#include <GLM/glm.hpp>
+
+#include <PropRoom3D/libPropRoom3D_global.h>
+
+
+namespace prop3
+{
+    class Tile;
+
+    // Worker's own accumulation of the samples of a tile. Samples and
+    // their variance terms stay in flat local buffers while the tile
+    // is shot, and reach the film in a single merge.
+    class PROP3D_EXPORT ScratchTile
+    {
+    public:
+        ScratchTile();
+
+        // Empties buffers and sizes them to the tile
+        void reset(const Tile& tile);
+
+        // Variance terms are taken against the pixel's film sample
+        // plus its local samples, once it weighs above threshold
+        void trackVariance(double weightThreshold,
+                           const glm::dvec3& maxPixelIntensity);
+        void setFilmSample(int index, const glm::dvec4& sample);
+
+        void addSample(const glm::ivec2& position,
+                       const glm::dvec4& sample);
+
+        const glm::ivec2& minCorner() const;
+        const glm::ivec2& maxCorner() const;
+        size_t pixelCount() const;
+
+        // Local pixels are numbered row by row from min corner
+        const glm::dvec4& sample(int index) const;
+        const glm::dvec2& variance(int index) const;
+
+        // Number of samples added to the pixel
+        unsigned int sampleCount(int index) const;
+
+        // Weighted squared distance between a sample's color and its
+        // pixel's mean, both clamped to max intensity. The sample's
+        // weight is returned alongside.
+        static glm::dvec2 varianceTerm(
+                const glm::dvec4& pixelSample,
+                const glm::dvec4& sample,
+                const glm::dvec3& maxPixelIntensity);
+
+    private:
+        glm::ivec2 _minCorner;
+        glm::ivec2 _maxCorner;
+        int _width;
+
+        bool _tracksVariance;
+        double _varianceWeightThreshold;
+        glm::dvec3 _maxPixelIntensity;
+
+        std::vector<glm::dvec4> _filmSamples;
+        std::vector<glm::dvec4> _samples;
+        std::vector<glm::dvec2> _variances;
+        std::vector<unsigned int> _sampleCounts;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline void ScratchTile::setFilmSample(int index, const glm::dvec4& sample)
+    {
+        _filmSamples[index] = sample;
+    }
+
+    inline void ScratchTile::addSample(
+            const glm::ivec2& position,
+            const glm::dvec4& sample)
+    {
+        int index = (position.y - _minCorner.y) * _width +
+                    (position.x - _minCorner.x);
+
+        glm::dvec4& localSample = _samples[index];
+
+        if(_tracksVariance)
+        {
+            glm::dvec4 pixelSample = _filmSamples[index] + localSample;
+            if(pixelSample.w > _varianceWeightThreshold)
+            {
+                _variances[index] += varianceTerm(
+                    pixelSample, sample, _maxPixelIntensity);
+            }
+        }
+
+        localSample += sample;
+        ++_sampleCounts[index];
+    }
+
+    inline const glm::ivec2& ScratchTile::minCorner() const
+    {
+        return _minCorner;
+    }
+
+    inline const glm::ivec2& ScratchTile::maxCorner() const
+    {
+        return _maxCorner;
+    }
+
+    inline size_t ScratchTile::pixelCount() const
+    {
+        return _samples.size();
+    }
+
+    inline const glm::dvec4& ScratchTile::sample(int index) const
+    {
+        return _samples[index];
+    }
+
+    inline const glm::dvec2& ScratchTile::variance(int index) const
+    {
+        return _variances[index];
+    }
+
+    inline unsigned int ScratchTile::sampleCount(int index) const
+    {
+        return _sampleCounts[index];
+    }
+}
+
+#endif // PROPROOM3D_SCRATCHTILE_H
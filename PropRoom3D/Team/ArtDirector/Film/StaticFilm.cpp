@@ -24,9 +24,10 @@ namespace prop3
         _newTileCompleted = false;
         _newFrameCompleted = false;
 
-        _nextTileId = 0;
         _framePassCount = 0;
         _priorityThreshold = 0.0;
+
+        seedTiles();
     }
 
     void StaticFilm::clearBuffers(const glm::dvec3& color)
@@ -79,7 +80,7 @@ namespace prop3
 
     bool StaticFilm::needNewTiles() const
     {
-        return _nextTileId < _tiles.size();
+        return !_tileScheduler.isEmpty();
     }
 
     void StaticFilm::tileCompleted(Tile& tile)
@@ -102,7 +103,8 @@ namespace prop3
 
     void StaticFilm::rewindTiles()
     {
-        _nextTileId = 0;
+        std::lock_guard<std::mutex> lk(_tilesMutex);
+        seedTiles();
     }
 
     void StaticFilm::endTileReached()
@@ -120,6 +122,11 @@ namespace prop3
         return 1.0;
     }
 
+    unsigned int StaticFilm::pixelSampleCount(int index) const
+    {
+        return 1;
+    }
+
     glm::dvec4 StaticFilm::pixelSample(int index) const
     {
         return glm::dvec4(_colorBuffer[index], 1.0);
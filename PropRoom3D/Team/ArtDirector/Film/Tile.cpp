@@ -55,7 +55,10 @@ namespace prop3
         _maxCorner(maxCorner),
         _startPix(_minCorner + glm::ivec2(-1, 0)),
         _tilePriority(1.0),
-        _divergence(0.0)
+        _divergence(0.0),
+        _nextSubTile(0),
+        _pendingSubTiles(0),
+        _queuedPassCount(0)
     {
         glm::ivec2 tileDim = _maxCorner - _minCorner;
         _pixelCount = tileDim.x * + tileDim.y;
@@ -84,13 +87,85 @@ namespace prop3
     void Tile::lock()
     {
         _mutex.lock();
+
+        for(const std::shared_ptr<Tile>& subTile : _subTiles)
+            subTile->lock();
     }
 
     void Tile::unlock()
     {
+        for(auto it = _subTiles.rbegin(); it != _subTiles.rend(); ++it)
+            (*it)->unlock();
+
         _mutex.unlock();
     }
 
+    void Tile::split(int subTileHeight)
+    {
+        _subTiles.clear();
+        for(int y = _minCorner.y; y < _maxCorner.y; y += subTileHeight)
+        {
+            glm::ivec2 minCorner(_minCorner.x, y);
+            glm::ivec2 maxCorner(_maxCorner.x,
+                glm::min(y + subTileHeight, _maxCorner.y));
+
+            _subTiles.push_back(std::make_shared<Tile>(
+                _film, minCorner, maxCorner));
+        }
+
+        std::lock_guard<std::mutex> lk(_passMutex);
+        _nextSubTile.store(int(_subTiles.size()));
+        _pendingSubTiles = 0;
+        _queuedPassCount = 0;
+    }
+
+    std::shared_ptr<Tile> Tile::claimSubTile()
+    {
+        if(_nextSubTile.load() >= int(_subTiles.size()))
+            return std::shared_ptr<Tile>();
+
+        int id = _nextSubTile.fetch_add(1);
+        if(id >= int(_subTiles.size()))
+            return std::shared_ptr<Tile>();
+
+        return _subTiles[id];
+    }
+
+    int Tile::unclaimedSubTileCount() const
+    {
+        return glm::max(int(_subTiles.size()) - _nextSubTile.load(), 0);
+    }
+
+    void Tile::rewindSubTiles()
+    {
+        std::lock_guard<std::mutex> lk(_passMutex);
+        if(_pendingSubTiles > 0)
+        {
+            ++_queuedPassCount;
+            return;
+        }
+
+        _pendingSubTiles = int(_subTiles.size());
+        _nextSubTile.store(0);
+    }
+
+    bool Tile::subTileCompleted()
+    {
+        std::lock_guard<std::mutex> lk(_passMutex);
+        return --_pendingSubTiles == 0;
+    }
+
+    void Tile::startQueuedPass()
+    {
+        std::lock_guard<std::mutex> lk(_passMutex);
+        if(_queuedPassCount > 0 && _pendingSubTiles == 0)
+        {
+            --_queuedPassCount;
+            _pendingSubTiles = int(_subTiles.size());
+            _nextSubTile.store(0);
+        }
+    }
+
     glm::dvec4 Tile::pixelSample(int i, int j) const
     {
         return _film.pixelSample(i, j);
@@ -115,6 +190,16 @@ namespace prop3
         return _film.pixelPriority(position);
     }
 
+    unsigned int Tile::pixelSampleCount(const glm::ivec2& position) const
+    {
+        return _film.pixelSampleCount(position);
+    }
+
+    unsigned int Tile::pixelFirstSample(const glm::ivec2& position) const
+    {
+        return _film.pixelFirstSample(position);
+    }
+
     double Tile::priorityThreshold() const
     {
         return _film.priorityThreshold();
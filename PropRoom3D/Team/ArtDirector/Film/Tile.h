@@ -2,6 +2,9 @@
 #define PROPROOM3D_TILE_H
 
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include <GLM/glm.hpp>
 
@@ -22,6 +25,8 @@ namespace prop3
         glm::ivec2 position() const;
         double sampleWeight() const;
         double sampleMultiplicity() const;
+        unsigned int sampleCount() const;
+        unsigned int firstSample() const;
 
         TileIterator& operator++();
 
@@ -53,9 +58,29 @@ namespace prop3
         TileIterator begin();
         TileIterator end();
 
+        // Also locks sub-tiles
         void lock();
         void unlock();
 
+        // Horizontal bands of the tile. They are shot independently
+        // so that idle workers can help finishing the tile.
+        void split(int subTileHeight);
+        std::shared_ptr<Tile> claimSubTile();
+        int unclaimedSubTileCount() const;
+
+        // Starts a new pass over the sub-tiles. When sub-tiles of the
+        // previous pass are still being shot, the new pass is queued
+        // and starts once they all completed.
+        void rewindSubTiles();
+
+        // Returns true when the last pending sub-tile completes
+        bool subTileCompleted();
+
+        // Starts the pass queued while the tile was being shot.
+        // Called once the completed pass has been handed to the film.
+        void startQueuedPass();
+
+
         glm::dvec4 pixelSample(int i, int j) const;
         void addSample(int i, int j,
                        const glm::dvec4& sample);
@@ -64,6 +89,10 @@ namespace prop3
 
         double pixelPriority(const glm::ivec2& position) const;
 
+        unsigned int pixelSampleCount(const glm::ivec2& position) const;
+
+        unsigned int pixelFirstSample(const glm::ivec2& position) const;
+
         double priorityThreshold() const;
 
         double sampleMultiplicity() const;
@@ -87,6 +116,12 @@ namespace prop3
         unsigned int _pixelCount;
         double _tilePriority;
         double _divergence;
+
+        std::vector<std::shared_ptr<Tile>> _subTiles;
+        std::atomic<int> _nextSubTile;
+        std::mutex _passMutex;
+        int _pendingSubTiles;
+        int _queuedPassCount;
     };
 
 
@@ -102,6 +137,16 @@ namespace prop3
         return _tile.sampleMultiplicity();
     }
 
+    inline unsigned int TileIterator::sampleCount() const
+    {
+        return _tile.pixelSampleCount(_position);
+    }
+
+    inline unsigned int TileIterator::firstSample() const
+    {
+        return _tile.pixelFirstSample(_position);
+    }
+
     inline bool TileIterator::operator==(const TileIterator& it) const
     {
         return _position == it._position;
@@ -0,0 +1,207 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+
+namespace prop3
+{
+    const size_t TileScheduler::NO_TILE = size_t(-1);
+
+    const uint64_t NO_RANK = uint64_t(-1);
+
+
+    TileScheduler::TileScheduler() :
+        _workerCount(0),
+        _tileCount(0),
+        _nodeCount(1),
+        _generation(0)
+    {
+        resize(1, 0);
+    }
+
+    TileScheduler::~TileScheduler()
+    {
+
+    }
+
+    void TileScheduler::resize(size_t workerCount, size_t tileCount)
+    {
+        _workerCount = std::max(workerCount, size_t(1));
+        _tileCount = tileCount;
+
+        _items.reset(new std::atomic<uint64_t>[_tileCount]);
+        _deques.reset(new std::atomic<uint64_t>[_workerCount]);
+        _activeTiles.reset(new std::atomic<size_t>[_workerCount]);
+
+        for(size_t d=0; d < _workerCount; ++d)
+        {
+            _deques[d].store(pack(_generation, 0, 0));
+            _activeTiles[d].store(NO_TILE);
+        }
+
+        groupWorkers();
+    }
+
+    void TileScheduler::setNodes(
+            const std::vector<size_t>& workerNodes,
+            const std::vector<size_t>& tileNodes)
+    {
+        _workerNodes = workerNodes;
+        _tileNodes = tileNodes;
+        groupWorkers();
+    }
+
+    void TileScheduler::seed(const std::vector<size_t>& tileIds)
+    {
+        ++_generation;
+
+        // Empty deques first : takers that read an item of the
+        // previous pass will then fail to commit it.
+        for(size_t d=0; d < _workerCount; ++d)
+            _deques[d].exchange(pack(_generation, 0, 0),
+                                std::memory_order_acq_rel);
+
+        size_t itemCount = std::min(tileIds.size(), _tileCount);
+
+        // Ranks count rounds over the home node's own tiles.
+        // Tiles of nodes without workers are dealt to everyone.
+        for(std::vector<uint64_t>& dealt : _dealtItems)
+            dealt.clear();
+
+        std::vector<size_t> nodeTileCounts(_nodeCount, 0);
+        for(size_t i=0; i < itemCount; ++i)
+        {
+            size_t node = tileNode(tileIds[i]);
+            const std::vector<size_t>& workers = _nodeWorkers[node];
+            size_t rank = nodeTileCounts[node]++;
+            size_t d = workers.empty() ? rank % _workerCount :
+                                         workers[rank % workers.size()];
+
+            _dealtItems[d].push_back(item(rank, tileIds[i]));
+        }
+
+        size_t end = 0;
+        for(size_t d=0; d < _workerCount; ++d)
+        {
+            size_t beg = end;
+            for(uint64_t dealt : _dealtItems[d])
+                _items[end++].store(dealt, std::memory_order_relaxed);
+
+            _deques[d].store(pack(_generation, beg, end),
+                             std::memory_order_release);
+        }
+    }
+
+    bool TileScheduler::take(size_t workerId, size_t& tileId)
+    {
+        size_t own = workerId % _workerCount;
+        const std::vector<size_t>& nodeWorkers = _nodeWorkers[workerNode(own)];
+
+        while(true)
+        {
+            size_t best = own;
+            uint64_t bestRank = frontRank(own);
+
+            // Slower workers' deques lag behind by whole rounds
+            for(size_t d : nodeWorkers)
+            {
+                uint64_t rank = frontRank(d);
+                if(rank < bestRank && (bestRank == NO_RANK ||
+                   bestRank - rank >= nodeWorkers.size()))
+                {
+                    best = d;
+                    bestRank = rank;
+                }
+            }
+
+            // Tiles of other nodes are only taken once the node ran out
+            if(bestRank == NO_RANK)
+            {
+                for(size_t d=0; d < _workerCount; ++d)
+                {
+                    uint64_t rank = frontRank(d);
+                    if(rank < bestRank)
+                    {
+                        best = d;
+                        bestRank = rank;
+                    }
+                }
+            }
+
+            if(bestRank == NO_RANK)
+                return false;
+
+            if(popFront(best, tileId))
+                return true;
+        }
+    }
+
+    bool TileScheduler::isEmpty() const
+    {
+        for(size_t d=0; d < _workerCount; ++d)
+        {
+            uint64_t state = _deques[d].load(std::memory_order_acquire);
+            if(head(state) < tail(state))
+                return false;
+        }
+
+        return true;
+    }
+
+    void TileScheduler::setActiveTile(size_t workerId, size_t tileId)
+    {
+        _activeTiles[workerId % _workerCount].store(
+            tileId, std::memory_order_release);
+    }
+
+    size_t TileScheduler::activeTile(size_t workerId) const
+    {
+        return _activeTiles[workerId % _workerCount].load(
+            std::memory_order_acquire);
+    }
+
+    void TileScheduler::groupWorkers()
+    {
+        _nodeCount = 1;
+        for(size_t w=0; w < _workerCount; ++w)
+            _nodeCount = std::max(_nodeCount, workerNode(w) + 1);
+
+        _nodeWorkers.assign(_nodeCount, std::vector<size_t>());
+        for(size_t w=0; w < _workerCount; ++w)
+            _nodeWorkers[workerNode(w)].push_back(w);
+
+        _dealtItems.resize(_workerCount);
+    }
+
+    uint64_t TileScheduler::frontRank(size_t dequeId) const
+    {
+        uint64_t state = _deques[dequeId].load(std::memory_order_acquire);
+        if(head(state) >= tail(state))
+            return NO_RANK;
+
+        // May be outdated, it only guides the choice of a deque
+        return rank(_items[head(state)].load(std::memory_order_relaxed));
+    }
+
+    bool TileScheduler::popFront(size_t dequeId, size_t& tileId)
+    {
+        std::atomic<uint64_t>& deque = _deques[dequeId];
+        uint64_t state = deque.load(std::memory_order_acquire);
+
+        while(head(state) < tail(state))
+        {
+            uint64_t front = _items[head(state)].load(std::memory_order_relaxed);
+            uint64_t next = pack(generation(state), head(state) + 1, tail(state));
+
+            if(deque.compare_exchange_weak(state, next,
+                    std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+            {
+                tileId = TileScheduler::tileId(front);
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
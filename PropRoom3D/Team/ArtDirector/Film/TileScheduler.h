@@ -0,0 +1,142 @@
+#ifndef PROPROOM3D_TILESCHEDULER_H
+#define PROPROOM3D_TILESCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include <PropRoom3D/libPropRoom3D_global.h>
+
+
+namespace prop3
+{
+    // Lock-free work-stealing distribution of a film's tiles.
+    // Each worker owns a deque of tile ids sorted by decreasing
+    // priority. Workers consume their own deque's front, but take
+    // from another deque's front when it holds noisier tiles. Tiles
+    // are dealt once per pass by seed(). On NUMA machines, tiles have
+    // a home node : they are dealt to that node's workers only, and
+    // other nodes' workers take them once their own node ran out.
+    class PROP3D_EXPORT TileScheduler
+    {
+    public:
+        TileScheduler();
+        ~TileScheduler();
+
+        // Must not be called while workers are taking tiles
+        void resize(size_t workerCount, size_t tileCount);
+        size_t workerCount() const;
+
+        // Node of each worker and home node of each tile. Without
+        // nodes, every worker and tile belongs to node 0. Must not be
+        // called while workers are taking tiles.
+        void setNodes(const std::vector<size_t>& workerNodes,
+                      const std::vector<size_t>& tileNodes);
+
+        // Deals tile ids, given in decreasing priority order,
+        // round-robin over their home node workers' deques. Calls
+        // must be serialized, but workers may keep taking tiles
+        // meanwhile.
+        void seed(const std::vector<size_t>& tileIds);
+
+        // Pops the noisiest tile left of worker's node. Worker's own
+        // deque is preferred among tiles dealt in the same round.
+        bool take(size_t workerId, size_t& tileId);
+
+        bool isEmpty() const;
+
+        // Tile currently processed by a worker, that others may help
+        void setActiveTile(size_t workerId, size_t tileId);
+        size_t activeTile(size_t workerId) const;
+
+        static const size_t NO_TILE;
+
+    private:
+        // Deque state is packed in a single word :
+        // generation (16 bits), head (24 bits), tail (24 bits)
+        static uint64_t pack(uint64_t gen, uint64_t head, uint64_t tail);
+        static uint64_t generation(uint64_t state);
+        static uint64_t head(uint64_t state);
+        static uint64_t tail(uint64_t state);
+
+        // Items pack the tile's priority rank with its id
+        static uint64_t item(uint64_t rank, uint64_t tileId);
+        static uint64_t rank(uint64_t item);
+        static uint64_t tileId(uint64_t item);
+
+        uint64_t frontRank(size_t dequeId) const;
+        bool popFront(size_t dequeId, size_t& tileId);
+
+        void groupWorkers();
+        size_t workerNode(size_t workerId) const;
+        size_t tileNode(size_t tileId) const;
+
+        size_t _workerCount;
+        size_t _tileCount;
+        size_t _nodeCount;
+        std::vector<size_t> _workerNodes;
+        std::vector<size_t> _tileNodes;
+        std::vector<std::vector<size_t>> _nodeWorkers;
+        std::vector<std::vector<uint64_t>> _dealtItems;
+        uint64_t _generation;
+        std::unique_ptr<std::atomic<uint64_t>[]> _items;
+        std::unique_ptr<std::atomic<uint64_t>[]> _deques;
+        std::unique_ptr<std::atomic<size_t>[]> _activeTiles;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline size_t TileScheduler::workerCount() const
+    {
+        return _workerCount;
+    }
+
+    inline size_t TileScheduler::workerNode(size_t workerId) const
+    {
+        return workerId < _workerNodes.size() ? _workerNodes[workerId] : 0;
+    }
+
+    inline size_t TileScheduler::tileNode(size_t tileId) const
+    {
+        return tileId < _tileNodes.size() ? _tileNodes[tileId] % _nodeCount : 0;
+    }
+
+    inline uint64_t TileScheduler::pack(uint64_t gen, uint64_t head, uint64_t tail)
+    {
+        return ((gen & 0xffff) << 48) | (head << 24) | tail;
+    }
+
+    inline uint64_t TileScheduler::generation(uint64_t state)
+    {
+        return state >> 48;
+    }
+
+    inline uint64_t TileScheduler::head(uint64_t state)
+    {
+        return (state >> 24) & 0xffffff;
+    }
+
+    inline uint64_t TileScheduler::tail(uint64_t state)
+    {
+        return state & 0xffffff;
+    }
+
+    inline uint64_t TileScheduler::item(uint64_t rank, uint64_t tileId)
+    {
+        return (rank << 32) | tileId;
+    }
+
+    inline uint64_t TileScheduler::rank(uint64_t item)
+    {
+        return item >> 32;
+    }
+
+    inline uint64_t TileScheduler::tileId(uint64_t item)
+    {
+        return item & 0xffffffff;
+    }
+}
+
+#endif // PROPROOM3D_TILESCHEDULER_H
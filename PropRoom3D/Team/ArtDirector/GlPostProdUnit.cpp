@@ -1,6 +1,7 @@
 #include "GlPostProdUnit.h"
 
 #include <cassert>
+#include <cstring>
 
 #include <GLM/gtc/constants.hpp>
 
@@ -24,6 +25,11 @@ namespace prop3
 
     GlPostProdUnit::GlPostProdUnit() :
         _colorBufferTexId(0),
+        _depthBufferTexId(0),
+        _textureSize(0, 0),
+        _uploadedFilm(nullptr),
+        _unpackBuffers{0},
+        _nextUnpackBuffer(0),
         _fullscreenVao(0),
         _fullscreenVbo(0),
         _subroutineAvailable(false),
@@ -46,10 +52,13 @@ namespace prop3
     GlPostProdUnit::~GlPostProdUnit()
     {
         glDeleteTextures(1, &_colorBufferTexId);
+        glDeleteTextures(1, &_depthBufferTexId);
         glDeleteVertexArrays(1, &_fullscreenVao);
         glDeleteBuffers(1, &_fullscreenVbo);
+        glDeleteBuffers(UNPACK_BUFFER_COUNT, _unpackBuffers);
 
         _colorBufferTexId = 0;
+        _depthBufferTexId = 0;
         _fullscreenVao = 0;
         _fullscreenVbo = 0;
     }
@@ -108,6 +117,9 @@ namespace prop3
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glBindTexture(GL_TEXTURE_2D, 0);
 
+        // Color upload buffers
+        glGenBuffers(UNPACK_BUFFER_COUNT, _unpackBuffers);
+
         clearOutput();
 
 
@@ -196,6 +208,9 @@ namespace prop3
                      GL_RED, GL_FLOAT, &maxDepth);
 
         glBindTexture(GL_TEXTURE_2D, 0);
+
+        _textureSize = glm::ivec2(0, 0);
+        _uploadedFilm = nullptr;
     }
 
     void GlPostProdUnit::update(Film& film,
@@ -204,8 +219,15 @@ namespace prop3
         glm::ivec2 viewportSize = film.frameResolution();
         const std::vector<float>& depthBuffer = film.depthBuffer();
         const std::vector<glm::vec3>& colorBuffer = film.colorBuffer(colorOutput);
+        std::vector<Film::Region> regions = film.takeDirtyRegions();
+
+        if(viewportSize == _textureSize && &film == _uploadedFilm)
+        {
+            uploadRegions(colorBuffer, depthBuffer, regions);
+            return;
+        }
 
-        // Send image to GPU
+        // Send whole image to GPU
         glBindTexture(GL_TEXTURE_2D, _colorBufferTexId);
         glTexImage2D(GL_TEXTURE_2D,         0,  GL_RGB32F,
                      viewportSize.x,        viewportSize.y,
@@ -220,6 +242,115 @@ namespace prop3
         }
 
         glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Unpack buffers can hold a whole frame
+        GLsizeiptr frameSize = GLsizeiptr(viewportSize.x) *
+            viewportSize.y * sizeof(glm::vec3);
+        for(int b=0; b < UNPACK_BUFFER_COUNT; ++b)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _unpackBuffers[b]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, frameSize,
+                         nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        _textureSize = viewportSize;
+        _uploadedFilm = &film;
+    }
+
+    void GlPostProdUnit::uploadRegions(
+            const std::vector<glm::vec3>& colorBuffer,
+            const std::vector<float>& depthBuffer,
+            const std::vector<Film::Region>& regions)
+    {
+        if(regions.empty())
+            return;
+
+        size_t regionsSize = 0;
+        for(const Film::Region& region : regions)
+        {
+            glm::ivec2 dim = region.maxCorner - region.minCorner;
+            regionsSize += size_t(dim.x) * dim.y * sizeof(glm::vec3);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, _colorBufferTexId);
+
+        // Pack regions one after the other in next unpack buffer
+        unsigned int unpackBuffer = _unpackBuffers[_nextUnpackBuffer];
+        _nextUnpackBuffer = (_nextUnpackBuffer + 1) % UNPACK_BUFFER_COUNT;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+        char* staging = (char*) glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, regionsSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+        if(staging != nullptr)
+        {
+            size_t offset = 0;
+            for(const Film::Region& region : regions)
+            {
+                int width = region.maxCorner.x - region.minCorner.x;
+                size_t rowSize = width * sizeof(glm::vec3);
+                for(int j=region.minCorner.y; j < region.maxCorner.y; ++j)
+                {
+                    const glm::vec3* row = &colorBuffer[
+                        j * _textureSize.x + region.minCorner.x];
+                    memcpy(staging + offset, row, rowSize);
+                    offset += rowSize;
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            size_t regionOffset = 0;
+            for(const Film::Region& region : regions)
+            {
+                glm::ivec2 dim = region.maxCorner - region.minCorner;
+                glTexSubImage2D(GL_TEXTURE_2D, 0,
+                    region.minCorner.x, region.minCorner.y,
+                    dim.x, dim.y, GL_RGB, GL_FLOAT,
+                    (const void*) regionOffset);
+                regionOffset += size_t(dim.x) * dim.y * sizeof(glm::vec3);
+            }
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+            cellar::getLog().postMessage(new cellar::Message('W', false,
+                "Could not map pixel unpack buffer. Uploading regions directly.",
+                "GlPostProdUnit"));
+
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, _textureSize.x);
+            for(const Film::Region& region : regions)
+            {
+                glm::ivec2 dim = region.maxCorner - region.minCorner;
+                glTexSubImage2D(GL_TEXTURE_2D, 0,
+                    region.minCorner.x, region.minCorner.y,
+                    dim.x, dim.y, GL_RGB, GL_FLOAT, &colorBuffer[
+                        region.minCorner.y * _textureSize.x + region.minCorner.x]);
+            }
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+
+        // Depth regions are read straight from film's buffer
+        if(!depthBuffer.empty())
+        {
+            glBindTexture(GL_TEXTURE_2D, _depthBufferTexId);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, _textureSize.x);
+            for(const Film::Region& region : regions)
+            {
+                glm::ivec2 dim = region.maxCorner - region.minCorner;
+                glTexSubImage2D(GL_TEXTURE_2D, 0,
+                    region.minCorner.x, region.minCorner.y,
+                    dim.x, dim.y, GL_RED, GL_FLOAT, &depthBuffer[
+                        region.minCorner.y * _textureSize.x + region.minCorner.x]);
+            }
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void GlPostProdUnit::activateLowPassFilter(bool activate)
@@ -52,10 +52,24 @@ namespace prop3
         static void buildLowpassKernel(float kernel[], double variance, int size);
         static void updateLowpassKernelUniform(cellar::GlProgram& prog, float kernel[], int size);
 
+        // Sends only film's dirty regions when texture is up to date
+        virtual void uploadRegions(
+                const std::vector<glm::vec3>& colorBuffer,
+                const std::vector<float>& depthBuffer,
+                const std::vector<Film::Region>& regions);
+
 
     private:
         unsigned int _colorBufferTexId;
         unsigned int _depthBufferTexId;
+        glm::ivec2 _textureSize;
+        const Film* _uploadedFilm;
+
+        // Color regions are staged through a ring of pixel unpack
+        // buffers, so that mapping one never waits on a pending upload
+        static const int UNPACK_BUFFER_COUNT = 3;
+        unsigned int _unpackBuffers[UNPACK_BUFFER_COUNT];
+        int _nextUnpackBuffer;
 
         cellar::GlProgram _postProdProgram;
         unsigned int _fullscreenVao;
@@ -0,0 +1,212 @@
+#include "LightTree.h"
+
+#include <algorithm>
+
+#include "Node/Light/LightBulb/LightBulb.h"
+#include "Node/Prop/Surface/Surface.h"
+
+
+namespace prop3
+{
+    const size_t LightTree::NO_LIGHT = size_t(-1);
+
+    // Rec. 709 luminance of radiant flux
+    const glm::dvec3 POWER_LUMINANCE(0.2126, 0.7152, 0.0722);
+
+
+    LightTree::LightTree()
+    {
+
+    }
+
+    LightTree::~LightTree()
+    {
+
+    }
+
+    void LightTree::build(const std::vector<std::shared_ptr<const LightBulb>>& lights)
+    {
+        _nodes.clear();
+        _unboundedLights.clear();
+        _lightLeaves.assign(lights.size(), NO_LIGHT);
+        _lightBounds.assign(lights.size(), AxisAlignedBox());
+        _lightPowers.assign(lights.size(), 0.0);
+
+        std::vector<size_t> lightIds;
+        for(size_t l=0; l < lights.size(); ++l)
+        {
+            const AxisAlignedBox& bounds = lights[l]->surface()->boundingBox();
+            if(bounds.isEmpty() || bounds.isInfinite())
+            {
+                _unboundedLights.push_back(l);
+                continue;
+            }
+
+            _lightBounds[l] = bounds;
+            _lightPowers[l] = glm::dot(lights[l]->radiantFlux(), POWER_LUMINANCE);
+            lightIds.push_back(l);
+        }
+
+        if(lightIds.empty())
+            return;
+
+        _nodes.reserve(2 * lightIds.size() - 1);
+        buildNode(lightIds, 0, lightIds.size());
+    }
+
+    size_t LightTree::buildNode(
+            std::vector<size_t>& lightIds,
+            size_t begLight,
+            size_t endLight)
+    {
+        size_t nodeId = _nodes.size();
+        _nodes.push_back(LightNode());
+
+        AxisAlignedBox bounds;
+        AxisAlignedBox centers;
+        double power = 0.0;
+        for(size_t l=begLight; l < endLight; ++l)
+        {
+            bounds.extend(_lightBounds[lightIds[l]]);
+            centers.extend(_lightBounds[lightIds[l]].center());
+            power += _lightPowers[lightIds[l]];
+        }
+
+        size_t lightId = NO_LIGHT;
+        if(endLight - begLight == 1)
+        {
+            lightId = lightIds[begLight];
+            _lightLeaves[lightId] = nodeId;
+        }
+        else
+        {
+            // Median split along the widest extent of light centers
+            glm::dvec3 extent = centers.dimensions();
+            int axis = 0;
+            if(extent.y > extent[axis]) axis = 1;
+            if(extent.z > extent[axis]) axis = 2;
+
+            size_t midLight = (begLight + endLight) / 2;
+            std::nth_element(
+                lightIds.begin() + begLight,
+                lightIds.begin() + midLight,
+                lightIds.begin() + endLight,
+                [this, axis](size_t l1, size_t l2){
+                    return _lightBounds[l1].center()[axis] <
+                           _lightBounds[l2].center()[axis];
+            });
+
+            buildNode(lightIds, begLight, midLight);
+            buildNode(lightIds, midLight, endLight);
+        }
+
+        LightNode& node = _nodes[nodeId];
+        node.bounds = bounds;
+        node.power = power;
+        node.endNode = _nodes.size();
+        node.lightId = lightId;
+
+        return nodeId;
+    }
+
+    double LightTree::importance(
+            const LightNode& node,
+            const glm::dvec3& position) const
+    {
+        // Distance is clamped to the node's radius, so that
+        // no light inside or near the node is ever given up
+        glm::dvec3 center = node.bounds.center();
+        double radius2 = glm::dot(node.bounds.dimensions(),
+                                  node.bounds.dimensions()) / 4.0;
+        glm::dvec3 dist = position - center;
+        double dist2 = glm::max(glm::dot(dist, dist), radius2);
+
+        return node.power / dist2;
+    }
+
+    bool LightTree::sample(
+            const glm::dvec3& position,
+            double zeroToOne,
+            size_t& lightId,
+            double& probability) const
+    {
+        lightId = NO_LIGHT;
+        probability = 0.0;
+
+        if(_nodes.empty() || !(_nodes[0].power > 0.0))
+            return false;
+
+        double u = zeroToOne;
+        double prob = 1.0;
+        size_t nId = 0;
+        while(_nodes[nId].lightId == NO_LIGHT)
+        {
+            size_t firstId = nId + 1;
+            size_t secondId = _nodes[firstId].endNode;
+
+            double firstImp = importance(_nodes[firstId], position);
+            double secondImp = importance(_nodes[secondId], position);
+            double impSum = firstImp + secondImp;
+            if(!(impSum > 0.0))
+                return false;
+
+            // Reuse the uniform number's remaining precision
+            double firstProb = firstImp / impSum;
+            if(u < firstProb)
+            {
+                u = u / firstProb;
+                prob *= firstProb;
+                nId = firstId;
+            }
+            else
+            {
+                u = (u - firstProb) / (1.0 - firstProb);
+                prob *= 1.0 - firstProb;
+                nId = secondId;
+            }
+
+            u = glm::min(u, 1.0 - 1e-12);
+        }
+
+        lightId = _nodes[nId].lightId;
+        probability = prob;
+        return probability > 0.0;
+    }
+
+    double LightTree::probability(
+            const glm::dvec3& position,
+            size_t lightId) const
+    {
+        if(!isPickable(lightId) || !(_nodes[0].power > 0.0))
+            return 0.0;
+
+        // Follow the only path leading to the light's leaf
+        size_t leafId = _lightLeaves[lightId];
+        double prob = 1.0;
+        size_t nId = 0;
+        while(nId != leafId)
+        {
+            size_t firstId = nId + 1;
+            size_t secondId = _nodes[firstId].endNode;
+
+            double firstImp = importance(_nodes[firstId], position);
+            double secondImp = importance(_nodes[secondId], position);
+            double impSum = firstImp + secondImp;
+            if(!(impSum > 0.0))
+                return 0.0;
+
+            if(leafId < secondId)
+            {
+                prob *= firstImp / impSum;
+                nId = firstId;
+            }
+            else
+            {
+                prob *= 1.0 - firstImp / impSum;
+                nId = secondId;
+            }
+        }
+
+        return prob;
+    }
+}
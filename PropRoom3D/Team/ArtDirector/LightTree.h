@@ -0,0 +1,94 @@
+#ifndef PROPROOM3D_LIGHTTREE_H
+#define PROPROOM3D_LIGHTTREE_H
+
+#include <vector>
+#include <memory>
+
+#include <PropRoom3D/Ray/AxisAlignedBox.h>
+
+
+namespace prop3
+{
+    class LightBulb;
+
+
+    // Light hierarchy node. Nodes are stored in depth-first order :
+    // an inner node's first child follows it and its second child
+    // starts at the first child's endNode.
+    struct LightNode
+    {
+        AxisAlignedBox bounds;
+        double power;
+        size_t endNode;
+        size_t lightId;
+    };
+
+    // Bounding volume hierarchy of light bulbs, weighted by their
+    // power. Picks lights in proportion to their estimated
+    // contribution to a shading point.
+    class PROP3D_EXPORT LightTree
+    {
+    public:
+        LightTree();
+        ~LightTree();
+
+        // Lights are referred to by their index in given vector
+        void build(const std::vector<std::shared_ptr<const LightBulb>>& lights);
+
+        bool isEmpty() const;
+
+        // Lights without bounds, that can't be picked
+        const std::vector<size_t>& unboundedLights() const;
+
+        // Descends the tree with a single uniform number in [0, 1).
+        // Returns false if no bounded light can light position.
+        bool sample(const glm::dvec3& position,
+                    double zeroToOne,
+                    size_t& lightId,
+                    double& probability) const;
+
+        // Probability that sample() picks the light at position
+        double probability(const glm::dvec3& position,
+                           size_t lightId) const;
+
+        bool isPickable(size_t lightId) const;
+
+        static const size_t NO_LIGHT;
+
+    protected:
+        size_t buildNode(std::vector<size_t>& lightIds,
+                         size_t begLight,
+                         size_t endLight);
+
+        double importance(const LightNode& node,
+                          const glm::dvec3& position) const;
+
+    private:
+        std::vector<LightNode> _nodes;
+        std::vector<size_t> _lightLeaves;
+        std::vector<size_t> _unboundedLights;
+        std::vector<AxisAlignedBox> _lightBounds;
+        std::vector<double> _lightPowers;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline bool LightTree::isEmpty() const
+    {
+        return _nodes.empty();
+    }
+
+    inline const std::vector<size_t>& LightTree::unboundedLights() const
+    {
+        return _unboundedLights;
+    }
+
+    inline bool LightTree::isPickable(size_t lightId) const
+    {
+        return lightId < _lightLeaves.size() &&
+               _lightLeaves[lightId] != NO_LIGHT;
+    }
+}
+
+#endif // PROPROOM3D_LIGHTTREE_H
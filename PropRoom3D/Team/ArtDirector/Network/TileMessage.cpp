@@ -1,5 +1,7 @@
 #include "TileMessage.h"
 
+#include <vector>
+
 #include <QIODevice>
 #include <QDataStream>
 
@@ -7,6 +9,7 @@
 
 #include "../Film/Film.h"
 #include "../Film/Tile.h"
+#include "../Film/ScratchTile.h"
 
 using namespace cellar;
 
@@ -107,38 +110,42 @@ namespace prop3
 
         glm::ivec2 tileMin = tile->minCorner();
         glm::ivec2 tileMax = tile->maxCorner();
+        glm::ivec2 tileDim = tileMax - tileMin;
+
+        // Samples are read before locking the tile
+        std::vector<glm::vec4> samples(tileDim.x * tileDim.y);
+        int sampleSize = sizeof(glm::vec4) * samples.size();
+        if(stream.readRawData((char*)samples.data(), sampleSize) != sampleSize)
+        {
+            getLog().postMessage(new Message('E', false,
+                "There were too few samples in this tile message",
+                "TileMessage"));
+
+            _tileId = -1;
+            _buffer.close();
+            return;
+        }
+
+        // Received samples reach the film in a single merge,
+        // the way workers' samples do
+        ScratchTile scratch;
 
         tile->lock();
+        _film.prepareScratchTile(scratch, *tile);
+
+        int local = 0;
         for(int y = tileMin.y; y < tileMax.y; ++y)
         {
-            bool brk = false;
-
-            for(int x = tileMin.x; x < tileMax.x; ++x)
+            for(int x = tileMin.x; x < tileMax.x; ++x, ++local)
             {
-                glm::vec4 sample;
-
-                if(stream.readRawData((char*)&sample, sizeof(sample)) != sizeof(sample))
-                {
-                    getLog().postMessage(new Message('E', false,
-                        "There were too few samples in this tile message",
-                        "TileMessage"));
-
-                    _tileId = -1;
-                    brk = true;
-                    break;
-                }
-                else
-                {
-                    if(sample.w > 0.0)
-                        tile->addSample(x, y, sample);
-                }
+                const glm::vec4& sample = samples[local];
+                if(sample.w > 0.0)
+                    scratch.addSample(glm::ivec2(x, y), glm::dvec4(sample));
             }
-
-            if(brk) break;
         }
 
+        _film.mergeScratchTile(scratch);
         tile->unlock();
-        //_film.tileCompleted(*tile);
 
         _buffer.close();
     }
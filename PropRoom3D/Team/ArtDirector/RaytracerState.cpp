@@ -15,6 +15,16 @@ namespace prop3
 
     const std::string RaytracerState::UNSPECIFIED_RAW_FILE = "";
 
+    const std::string RaytracerState::SEQUENCE_WHITE_NOISE = "White noise";
+    const std::string RaytracerState::SEQUENCE_SOBOL = "Sobol";
+    const std::string RaytracerState::SEQUENCE_RANK1_LATTICE = "Rank-1 lattice";
+
+    const std::string RaytracerState::BOUNCE_RAY_TREE = "Ray tree";
+    const std::string RaytracerState::BOUNCE_SINGLE_PATH = "Single path";
+
+    const std::string RaytracerState::PIPELINE_PATH_BY_PATH = "Path by path";
+    const std::string RaytracerState::PIPELINE_WAVEFRONT = "Wavefront";
+
 
     RaytracerState::DraftParams::DraftParams() :
         levelCount(0),
@@ -45,6 +55,7 @@ namespace prop3
         _startTime(std::chrono::steady_clock::now()),
         _sampleCount(0),
         _divergence(1.0),
+        _prioritizationTime(0.0),
         _draftLevel(0),
         _draftParams()
     {
@@ -69,6 +80,11 @@ namespace prop3
         _workerCount = workerCount;
     }
 
+    void RaytracerState::ProtectedState::setTopologyReport(const std::string& report)
+    {
+        _topologyReport = report;
+    }
+
     void RaytracerState::ProtectedState::setInterrupted(bool interrupted)
     {
         _interrupted = interrupted;
@@ -79,6 +95,12 @@ namespace prop3
         _hiddenSurfacesRemoved = removed;
     }
 
+    void RaytracerState::ProtectedState::setVisibilityHistogram(
+            const std::vector<unsigned int>& bins)
+    {
+        _visibilityHistogram = bins;
+    }
+
     void RaytracerState::ProtectedState::incSampleCount()
     {
         ++_sampleCount;
@@ -99,6 +121,11 @@ namespace prop3
         _divergence = divergence;
     }
 
+    void RaytracerState::ProtectedState::setPrioritizationTime(double seconds)
+    {
+        _prioritizationTime = seconds;
+    }
+
     void RaytracerState::ProtectedState::setDraftParams(const DraftParams& draftParams)
     {
         _draftParams = draftParams;
@@ -114,6 +141,9 @@ namespace prop3
         _protectedState(state),
         _isUpdateEachTileEnabled(true),
         _colorOutputType(COLOROUTPUT_ALBEDO),
+        _sampleSequence(SEQUENCE_SOBOL),
+        _bounceMode(BOUNCE_RAY_TREE),
+        _pipeline(PIPELINE_PATH_BY_PATH),
         _sampleCountThreshold(std::numeric_limits<unsigned int>::max()),
         _renderTimeThreshold(std::numeric_limits<double>::infinity()),
         _divergenceThreshold(-1.0),
@@ -156,4 +186,19 @@ namespace prop3
     {
         _filmRawFilePath = filePath;
     }
+
+    void RaytracerState::setSampleSequence(const std::string& sequence)
+    {
+        _sampleSequence = sequence;
+    }
+
+    void RaytracerState::setBounceMode(const std::string& mode)
+    {
+        _bounceMode = mode;
+    }
+
+    void RaytracerState::setPipeline(const std::string& pipeline)
+    {
+        _pipeline = pipeline;
+    }
 }
@@ -3,6 +3,7 @@
 
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include "../../libPropRoom3D_global.h"
 
@@ -40,10 +41,14 @@ namespace prop3
 
             void setWorkerCount(int workerCount);
 
+            void setTopologyReport(const std::string& report);
+
             void setInterrupted(bool interrupted);
 
             void setHiddenSurfaceRemoved(bool removed);
 
+            void setVisibilityHistogram(const std::vector<unsigned int>& bins);
+
             void incSampleCount();
 
             void addSampleCount(unsigned int count);
@@ -52,6 +57,8 @@ namespace prop3
 
             void setDivergence(double divergence);
 
+            void setPrioritizationTime(double seconds);
+
             void setDraftLevel(int draftLevel);
 
             void setDraftParams(const DraftParams& draftParams);
@@ -62,12 +69,15 @@ namespace prop3
 
 
             int _workerCount;
+            std::string _topologyReport;
             bool _interrupted;
             bool _hiddenSurfacesRemoved;
+            std::vector<unsigned int> _visibilityHistogram;
 
             std::chrono::steady_clock::time_point _startTime;
             unsigned int _sampleCount;
             double _divergence;
+            double _prioritizationTime;
 
             DraftParams _draftParams;
             int _draftLevel;
@@ -78,6 +88,9 @@ namespace prop3
 
         int workerCount() const;
 
+        // Processors and NUMA nodes found, and where workers run
+        std::string topologyReport() const;
+
         bool interrupted() const;
 
 
@@ -103,6 +116,9 @@ namespace prop3
 
         bool converged() const;
 
+        // Seconds workers took to prioritize latest frame's pixels
+        double prioritizationTime() const;
+
 
         void setSurfaceVisibilityThreshold(double threshold);
 
@@ -112,6 +128,10 @@ namespace prop3
 
         bool hiddenSurfacesRemoved() const;
 
+        // Surface count per power of two bin of visibility hit counts,
+        // gathered when hidden surfaces were removed. Empty before.
+        const std::vector<unsigned int>& visibilityHistogram() const;
+
 
         int draftLevel() const;
 
@@ -146,6 +166,25 @@ namespace prop3
         std::string filmRawFilePath() const;
 
 
+        // Sequence of pixel, aperture and microfacet samples
+        void setSampleSequence(const std::string& sequence);
+
+        std::string sampleSequence() const;
+
+
+        // Ray tree expansion or single path per sample
+        void setBounceMode(const std::string& mode);
+
+        std::string bounceMode() const;
+
+
+        // Path by path or wavefront tracing. Takes effect when
+        // workers are set up.
+        void setPipeline(const std::string& pipeline);
+
+        std::string pipeline() const;
+
+
         static const std::string COLOROUTPUT_ALBEDO;
         static const std::string COLOROUTPUT_WEIGHT;
         static const std::string COLOROUTPUT_DIVERGENCE;
@@ -156,12 +195,25 @@ namespace prop3
 
         static const std::string UNSPECIFIED_RAW_FILE;
 
+        static const std::string SEQUENCE_WHITE_NOISE;
+        static const std::string SEQUENCE_SOBOL;
+        static const std::string SEQUENCE_RANK1_LATTICE;
+
+        static const std::string BOUNCE_RAY_TREE;
+        static const std::string BOUNCE_SINGLE_PATH;
+
+        static const std::string PIPELINE_PATH_BY_PATH;
+        static const std::string PIPELINE_WAVEFRONT;
+
 
     private:
         ProtectedState& _protectedState;
         bool _isUpdateEachTileEnabled;
         std::string _colorOutputType;
         std::string _filmRawFilePath;
+        std::string _sampleSequence;
+        std::string _bounceMode;
+        std::string _pipeline;
 
         unsigned int _sampleCountThreshold;
         double _renderTimeThreshold;
@@ -177,6 +229,11 @@ namespace prop3
         return _protectedState._workerCount;
     }
 
+    inline std::string RaytracerState::topologyReport() const
+    {
+        return _protectedState._topologyReport;
+    }
+
     inline bool RaytracerState::interrupted() const
     {
         return _protectedState._interrupted;
@@ -220,6 +277,11 @@ namespace prop3
         return _divergenceThreshold >= divergence();
     }
 
+    inline double RaytracerState::prioritizationTime() const
+    {
+        return _protectedState._prioritizationTime;
+    }
+
     inline double RaytracerState::surfaceVisibilityThreshold() const
     {
         return _surfaceVisibilityThreshold;
@@ -235,6 +297,11 @@ namespace prop3
         return _protectedState._hiddenSurfacesRemoved;
     }
 
+    inline const std::vector<unsigned int>& RaytracerState::visibilityHistogram() const
+    {
+        return _protectedState._visibilityHistogram;
+    }
+
     inline int RaytracerState::draftLevel() const
     {
         return _protectedState._draftLevel;
@@ -291,6 +358,21 @@ namespace prop3
     {
         return _filmRawFilePath;
     }
+
+    inline std::string RaytracerState::sampleSequence() const
+    {
+        return _sampleSequence;
+    }
+
+    inline std::string RaytracerState::bounceMode() const
+    {
+        return _bounceMode;
+    }
+
+    inline std::string RaytracerState::pipeline() const
+    {
+        return _pipeline;
+    }
 }
 
 #endif // PROPROOM3D_RAYTRACERSTATE_H
@@ -1,5 +1,7 @@
 #include "SearchStructure.h"
 
+#include <algorithm>
+
 #include <CellarWorkbench/Misc/Log.h>
 
 #include "Team/DummyTeam.h"
@@ -12,12 +14,21 @@
 #include "Serial/JsonReader.h"
 
 #include "Ray/RayHitList.h"
+#include "Ray/RayPacket.h"
 
 using namespace cellar;
 
 
 namespace prop3
 {
+    const size_t BVH_BIN_COUNT = 12;
+    const size_t BVH_MAX_LEAF_SIZE = 4;
+    const double BVH_TRAVERSAL_COST = 1.0;
+    const double BVH_INTERSECTION_COST = 2.0;
+
+    const size_t SearchStructure::NO_OCCLUDER = size_t(-1);
+
+
     SearchStructure::SearchStructure(const std::string &stageStream) :
         _team(new DummyTeam()),
         _isOptimized(false)
@@ -29,6 +40,7 @@ namespace prop3
         std::shared_ptr<StageSet> stageSet = _team->stageSet();
 
         _searchZones.clear();
+        _searchNodes.clear();
         _searchSurfaces.clear();
 
         if(!stageSet->isVisible())
@@ -97,7 +109,11 @@ namespace prop3
                 auto light = zone->lights()[l];
                 if(light->isVisible())
                 {
-                    _searchSurfaces.emplace_back(light->surface());
+                    // Surfaces with empty bounds can't be hit
+                    const AxisAlignedBox& bounds =
+                        light->surface()->boundingBox();
+                    if(!bounds.isEmpty())
+                        _searchSurfaces.emplace_back(light->surface(), bounds);
 
                     if(light->isOn())
                         _lights.push_back(light);
@@ -113,8 +129,10 @@ namespace prop3
                     size_t surfCount = prop->surfaces().size();
                     for(size_t s=0; s < surfCount; ++s)
                     {
-                        _searchSurfaces.emplace_back(
-                            prop->surfaces()[s]);
+                        const std::shared_ptr<Surface>& surf = prop->surfaces()[s];
+                        const AxisAlignedBox& bounds = surf->boundingBox();
+                        if(!bounds.isEmpty())
+                            _searchSurfaces.emplace_back(surf, bounds);
                     }
                 }
             }
@@ -131,6 +149,12 @@ namespace prop3
             searchZone.endSurf = _searchSurfaces.size();
             searchZone.begSurf = searchZone.endSurf - addedSurfaces;
             searchZone.bounds = zone->bounds().get();
+            if(searchZone.bounds != nullptr)
+            {
+                // Fill the bounds cache before workers share the zone
+                searchZone.bounds->boundingBox();
+            }
+            buildHierarchy(searchZone);
             _searchZones.push_back(searchZone);
         }
 
@@ -146,6 +170,45 @@ namespace prop3
         }
 
         _isEmpty = _searchSurfaces.empty();
+
+        _lightTree.build(_lights);
+        for(size_t l=0; l < _lights.size(); ++l)
+            _lightIds[_lights[l].get()] = l;
+    }
+
+    size_t SearchStructure::lightId(const LightBulb* light) const
+    {
+        auto it = _lightIds.find(light);
+        if(it != _lightIds.end())
+            return it->second;
+
+        return LightTree::NO_LIGHT;
+    }
+
+    SearchStructure::SearchStructure(
+            const std::shared_ptr<SearchStructure>& master) :
+        _team(master->_team),
+        _searchZones(master->_searchZones),
+        _searchNodes(master->_searchNodes),
+        _searchSurfaces(master->_searchSurfaces),
+        _isEmpty(master->_isEmpty),
+        _isOptimized(master->_isOptimized),
+        _lights(master->_lights),
+        _lightTree(master->_lightTree),
+        _lightIds(master->_lightIds),
+        _master(master)
+    {
+
+    }
+
+    std::shared_ptr<SearchStructure> SearchStructure::replicate()
+    {
+        std::shared_ptr<SearchStructure> master = _master;
+        if(master.get() == nullptr)
+            master = shared_from_this();
+
+        return std::shared_ptr<SearchStructure>(
+            new SearchStructure(master));
     }
 
     SearchStructure::~SearchStructure()
@@ -156,11 +219,13 @@ namespace prop3
     double SearchStructure::findNearestIntersection(
             const Raycast& raycast,
             RayHitReport& reportMin,
-            RayHitList& rayHitList) const
+            RayHitList& rayHitList,
+            HitCounters* hitCounters) const
     {
         Raycast ray(raycast);
 
         size_t minId = -1;
+        RayHitReport* nearest = nullptr;
 
         size_t zId = 0;
         size_t zoneCount = _searchZones.size();
@@ -171,23 +236,37 @@ namespace prop3
             if(zone.bounds == StageZone::UNBOUNDED.get() ||
                zone.bounds->intersects(ray, rayHitList))
             {
-                for(size_t s = zone.begSurf; s < zone.endSurf; ++s)
+                size_t nId = zone.begNode;
+                while(nId < zone.endNode)
                 {
-                    rayHitList.clear();
-
-                    _searchSurfaces[s]->raycast(ray, rayHitList);
+                    const SearchNode& searchNode = _searchNodes[nId];
 
-                    RayHitReport* node = rayHitList.head;
-                    while(node != nullptr)
+                    // Nodes beyond the nearest hit found so far are culled
+                    if(searchNode.bounds.intersects(ray))
                     {
-                        if(0.0 < node->length && node->length < ray.limit)
+                        for(size_t s = searchNode.begSurf; s < searchNode.endSurf; ++s)
                         {
-                            ray.limit = node->length;
-                            reportMin = *node;
-                            minId = s;
+                            rayHitList.clear();
+
+                            _searchSurfaces[s].program.raycast(ray, rayHitList);
+
+                            RayHitReport* hit = takeNearest(rayHitList, ray.limit);
+                            if(hit != nullptr)
+                            {
+                                if(nearest != nullptr)
+                                    rayHitList.dispose(nearest);
+
+                                nearest = hit;
+                                ray.limit = hit->length;
+                                minId = s;
+                            }
                         }
 
-                        node = node->_next;
+                        ++nId;
+                    }
+                    else
+                    {
+                        nId = searchNode.endNode;
                     }
                 }
 
@@ -199,21 +278,156 @@ namespace prop3
             }
         }
 
-        if(!_isOptimized && reportMin.length != raycast.limit)
+        if(nearest != nullptr)
         {
-            incrementCounter(_searchSurfaces[minId], ray.entropy);
+            reportMin = *nearest;
+            rayHitList.dispose(nearest);
+
+            if(!_isOptimized)
+                incrementCounter(hitCounters, minId, ray.entropy);
         }
 
         return reportMin.length;
     }
 
+    void SearchStructure::findNearestIntersections(
+            RayPacket& packet,
+            RayHitReport* reportMins,
+            RayHitList& rayHitList,
+            HitCounters* hitCounters) const
+    {
+        const int laneCount = packet.size();
+        const RayPacket::LaneMask lanes = packet.lanes();
+
+        size_t minIds[RayPacket::LANE_COUNT];
+        RayHitReport* nearests[RayPacket::LANE_COUNT];
+        for(int l=0; l < laneCount; ++l)
+        {
+            minIds[l] = -1;
+            nearests[l] = nullptr;
+        }
+
+        size_t zId = 0;
+        size_t zoneCount = _searchZones.size();
+        while(zId < zoneCount)
+        {
+            const SearchZone& zone = _searchZones[zId];
+
+            RayPacket::LaneMask zoneMask = lanes;
+            if(zone.bounds != StageZone::UNBOUNDED.get())
+            {
+                zoneMask = 0;
+                for(int l=0; l < laneCount; ++l)
+                {
+                    if(zone.bounds->intersects(packet.ray(l), rayHitList))
+                        zoneMask |= (1u << l);
+                }
+            }
+
+            if(zoneMask != 0)
+            {
+                size_t nId = zone.begNode;
+                while(nId < zone.endNode)
+                {
+                    const SearchNode& searchNode = _searchNodes[nId];
+
+                    // Only lanes that reach the node's box visit its surfaces
+                    RayPacket::LaneMask nodeMask =
+                        packet.intersects(searchNode.bounds) & zoneMask;
+
+                    if(nodeMask != 0)
+                    {
+                        for(size_t s = searchNode.begSurf; s < searchNode.endSurf; ++s)
+                        {
+                            for(int l=0; l < laneCount; ++l)
+                            {
+                                if(nodeMask & (1u << l))
+                                {
+                                    const Raycast& ray = packet.ray(l);
+
+                                    rayHitList.clear();
+
+                                    _searchSurfaces[s].program.raycast(ray, rayHitList);
+
+                                    RayHitReport* hit = takeNearest(rayHitList, ray.limit);
+                                    if(hit != nullptr)
+                                    {
+                                        if(nearests[l] != nullptr)
+                                            rayHitList.dispose(nearests[l]);
+
+                                        nearests[l] = hit;
+                                        packet.setLimit(l, hit->length);
+                                        minIds[l] = s;
+                                    }
+                                }
+                            }
+                        }
+
+                        ++nId;
+                    }
+                    else
+                    {
+                        nId = searchNode.endNode;
+                    }
+                }
+
+                ++zId;
+            }
+            else
+            {
+                zId = zone.endZone;
+            }
+        }
+
+        for(int l=0; l < laneCount; ++l)
+        {
+            if(nearests[l] != nullptr)
+            {
+                reportMins[l] = *nearests[l];
+                rayHitList.dispose(nearests[l]);
+
+                if(!_isOptimized)
+                    incrementCounter(hitCounters, minIds[l],
+                                     packet.ray(l).entropy);
+            }
+        }
+    }
+
     bool SearchStructure::intersectsScene(
             const Raycast& raycast,
             RayHitList& rayHitList,
+            HitCounters* hitCounters,
             double incomingEntropy) const
+    {
+        size_t occluder = NO_OCCLUDER;
+        return intersectsScene(raycast, rayHitList, hitCounters,
+                               incomingEntropy, occluder);
+    }
+
+    bool SearchStructure::intersectsScene(
+            const Raycast& raycast,
+            RayHitList& rayHitList,
+            HitCounters* hitCounters,
+            double incomingEntropy,
+            size_t& occluder) const
     {
         rayHitList.clear();
 
+        // Neighbor shadow rays are usually blocked by the same surface
+        if(occluder < _searchSurfaces.size())
+        {
+            if(_searchSurfaces[occluder].program.intersects(raycast, rayHitList))
+            {
+                if(!_isOptimized)
+                    incrementCounter(hitCounters, occluder,
+                                     incomingEntropy);
+
+                return true;
+            }
+
+            rayHitList.clear();
+        }
+
         size_t zId = 0;
         size_t zoneCount = _searchZones.size();
         while(zId < zoneCount)
@@ -223,15 +437,34 @@ namespace prop3
             if(zone.bounds == StageZone::UNBOUNDED.get() ||
                zone.bounds->intersects(raycast, rayHitList))
             {
-                for(size_t s = zone.begSurf; s < zone.endSurf; ++s)
+                size_t nId = zone.begNode;
+                while(nId < zone.endNode)
                 {
-                    if(_searchSurfaces[s]->intersects(raycast, rayHitList))
+                    const SearchNode& searchNode = _searchNodes[nId];
+
+                    if(searchNode.bounds.intersects(raycast))
                     {
-                        if(!_isOptimized)
-                            incrementCounter(_searchSurfaces[s],
-                                             incomingEntropy);
+                        for(size_t s = searchNode.begSurf; s < searchNode.endSurf; ++s)
+                        {
+                            if(s == occluder)
+                                continue;
+
+                            if(_searchSurfaces[s].program.intersects(raycast, rayHitList))
+                            {
+                                if(!_isOptimized)
+                                    incrementCounter(hitCounters, s,
+                                                     incomingEntropy);
+
+                                occluder = s;
+                                return true;
+                            }
+                        }
 
-                        return true;
+                        ++nId;
+                    }
+                    else
+                    {
+                        nId = searchNode.endNode;
                     }
                 }
 
@@ -246,11 +479,106 @@ namespace prop3
         return false;
     }
 
+    RayHitReport* SearchStructure::takeNearest(
+            RayHitList& reports,
+            double limit)
+    {
+        RayHitReport* nearest = nullptr;
+        RayHitReport* nearestParent = nullptr;
+
+        RayHitReport* parent = nullptr;
+        RayHitReport* node = reports.head;
+        while(node != nullptr)
+        {
+            if(0.0 < node->length && node->length < limit)
+            {
+                limit = node->length;
+                nearest = node;
+                nearestParent = parent;
+            }
+
+            parent = node;
+            node = node->_next;
+        }
+
+        if(nearest != nullptr)
+        {
+            if(nearestParent == nullptr)
+                reports.head = nearest->_next;
+            else
+                nearestParent->_next = nearest->_next;
+        }
+
+        return nearest;
+    }
+
+    std::shared_ptr<HitCounters> SearchStructure::createHitCounters()
+    {
+        if(_master.get() != nullptr)
+            return _master->createHitCounters();
+
+        liveHitCounters();
+
+        std::shared_ptr<HitCounters> counters(
+            new HitCounters(_searchSurfaces.size(), 0));
+        _hitCounters.push_back(counters);
+        return counters;
+    }
+
+    std::vector<std::shared_ptr<HitCounters>> SearchStructure::liveHitCounters()
+    {
+        std::vector<std::shared_ptr<HitCounters>> live;
+        std::vector<std::weak_ptr<HitCounters>> tracked;
+        for(const std::weak_ptr<HitCounters>& weak : _hitCounters)
+        {
+            std::shared_ptr<HitCounters> counters = weak.lock();
+            if(counters.get() != nullptr)
+            {
+                live.push_back(counters);
+                tracked.push_back(weak);
+            }
+        }
+
+        std::swap(_hitCounters, tracked);
+        return live;
+    }
+
+    void SearchStructure::reduceHitCounters()
+    {
+        for(const std::shared_ptr<HitCounters>& counters : liveHitCounters())
+        {
+            HitCounters& hits = *counters;
+            for(size_t i=0; i < hits.size(); ++i)
+            {
+                _searchSurfaces[i].hitCount += hits[i];
+                hits[i] = 0;
+            }
+        }
+    }
+
+    void SearchStructure::visibilityHistogram(
+            std::vector<unsigned int>& bins) const
+    {
+        bins.clear();
+        for(const SearchSurface& surf : _searchSurfaces)
+        {
+            size_t bin = 0;
+            for(long count = surf.hitCount; count > 0; count >>= 1)
+                ++bin;
+
+            if(bins.size() <= bin)
+                bins.resize(bin + 1, 0);
+            ++bins[bin];
+        }
+    }
+
     void SearchStructure::removeHiddenSurfaces(
             int threshold,
             size_t& removedZones,
             size_t& removedSurfaces)
     {
+        reduceHitCounters();
+
         removedZones = 0;
         removedSurfaces = 0;
 
@@ -261,8 +589,7 @@ namespace prop3
         std::vector<bool> removeSurface(_searchSurfaces.size());
         for(int i=0; i < _searchSurfaces.size(); ++i)
         {
-            bool remove = _searchSurfaces[i].hitCount
-                .load(std::memory_order_relaxed) < threshold;
+            bool remove = _searchSurfaces[i].hitCount < threshold;
 
             if(invertRemoval)
                 remove = !remove;
@@ -332,19 +659,190 @@ namespace prop3
 
         std::swap(_searchZones, newZones);
         std::swap(_searchSurfaces, newSurfs);
+
+        // Rebuild hierarchies over remaining surfaces
+        _searchNodes.clear();
+        for(SearchZone& zone : _searchZones)
+            buildHierarchy(zone);
+
+        // Remaining surfaces moved : keep counters aligned with them
+        for(const std::shared_ptr<HitCounters>& counters : liveHitCounters())
+            counters->assign(_searchSurfaces.size(), 0);
+
         _isOptimized = true;
     }
 
     void SearchStructure::resetHitCounters()
     {
         for(SearchSurface& surf : _searchSurfaces)
-            surf.hitCount.store(0);
+            surf.hitCount = 0;
+
+        for(const std::shared_ptr<HitCounters>& counters : liveHitCounters())
+            std::fill(counters->begin(), counters->end(), 0);
     }
 
     void SearchStructure::incrementCounter(
-            const SearchSurface& surf,
+            HitCounters* hitCounters,
+            size_t surfId,
             double entropy) const
     {
-        surf.hitCount.fetch_add(1 + (1.0-entropy) * 99);
+        if(hitCounters != nullptr)
+            (*hitCounters)[surfId] += 1 + (1.0-entropy) * 99;
+    }
+
+    void SearchStructure::buildHierarchy(SearchZone& zone)
+    {
+        zone.begNode = _searchNodes.size();
+
+        // Unbounded surfaces are gathered in a single leading leaf
+        auto begIt = _searchSurfaces.begin() + zone.begSurf;
+        auto endIt = _searchSurfaces.begin() + zone.endSurf;
+        auto midIt = std::partition(begIt, endIt,
+            [](const SearchSurface& s) { return s.bounds.isInfinite(); });
+        size_t midSurf = zone.begSurf + (midIt - begIt);
+
+        if(midSurf != zone.begSurf)
+        {
+            SearchNode leaf;
+            leaf.bounds = AxisAlignedBox::infinite();
+            leaf.endNode = _searchNodes.size() + 1;
+            leaf.begSurf = zone.begSurf;
+            leaf.endSurf = midSurf;
+            _searchNodes.push_back(leaf);
+        }
+
+        if(midSurf != zone.endSurf)
+        {
+            buildNode(midSurf, zone.endSurf);
+        }
+
+        zone.endNode = _searchNodes.size();
+    }
+
+    void SearchStructure::buildNode(size_t begSurf, size_t endSurf)
+    {
+        size_t nodeId = _searchNodes.size();
+        _searchNodes.push_back(SearchNode());
+
+        AxisAlignedBox bounds;
+        AxisAlignedBox centroids;
+        for(size_t s = begSurf; s < endSurf; ++s)
+        {
+            bounds.extend(_searchSurfaces[s].bounds);
+            centroids.extend(_searchSurfaces[s].bounds.center());
+        }
+
+        _searchNodes[nodeId].bounds = bounds;
+        _searchNodes[nodeId].begSurf = begSurf;
+        _searchNodes[nodeId].endSurf = endSurf;
+        _searchNodes[nodeId].endNode = nodeId + 1;
+
+        size_t surfCount = endSurf - begSurf;
+        if(surfCount <= 1)
+            return;
+
+
+        // Split along centroids' widest axis
+        glm::dvec3 extent = centroids.dimensions();
+        int axis = 0;
+        if(extent.y > extent[axis]) axis = 1;
+        if(extent.z > extent[axis]) axis = 2;
+
+        double cMin = centroids.minCorner[axis];
+        double cExt = extent[axis];
+
+        size_t splitBin = 0;
+        double splitCost = INFINITY;
+        if(cExt > 0.0)
+        {
+            // Binned surface area heuristic
+            AxisAlignedBox binBounds[BVH_BIN_COUNT];
+            size_t binCounts[BVH_BIN_COUNT] = {0};
+
+            auto binOf = [&](const SearchSurface& surf) {
+                double c = surf.bounds.center()[axis];
+                size_t b = size_t(BVH_BIN_COUNT * (c - cMin) / cExt);
+                return glm::min(b, BVH_BIN_COUNT - 1);
+            };
+
+            for(size_t s = begSurf; s < endSurf; ++s)
+            {
+                size_t b = binOf(_searchSurfaces[s]);
+                binBounds[b].extend(_searchSurfaces[s].bounds);
+                ++binCounts[b];
+            }
+
+            double rightArea[BVH_BIN_COUNT];
+            size_t rightCount[BVH_BIN_COUNT];
+            AxisAlignedBox rightBounds;
+            size_t rightSum = 0;
+            for(size_t b = BVH_BIN_COUNT-1; b > 0; --b)
+            {
+                rightBounds.extend(binBounds[b]);
+                rightSum += binCounts[b];
+                rightArea[b] = rightBounds.surfaceArea();
+                rightCount[b] = rightSum;
+            }
+
+            AxisAlignedBox leftBounds;
+            size_t leftSum = 0;
+            for(size_t b = 0; b < BVH_BIN_COUNT-1; ++b)
+            {
+                leftBounds.extend(binBounds[b]);
+                leftSum += binCounts[b];
+
+                if(leftSum == 0 || rightCount[b+1] == 0)
+                    continue;
+
+                double cost = leftBounds.surfaceArea() * leftSum +
+                              rightArea[b+1] * rightCount[b+1];
+                if(cost < splitCost)
+                {
+                    splitCost = cost;
+                    splitBin = b;
+                }
+            }
+
+            double area = bounds.surfaceArea();
+            if(area > 0.0)
+            {
+                splitCost = BVH_TRAVERSAL_COST +
+                    BVH_INTERSECTION_COST * splitCost / area;
+            }
+
+            double leafCost = BVH_INTERSECTION_COST * surfCount;
+            if(surfCount <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost)
+                return;
+
+            if(splitCost < INFINITY)
+            {
+                auto midIt = std::partition(
+                    _searchSurfaces.begin() + begSurf,
+                    _searchSurfaces.begin() + endSurf,
+                    [&](const SearchSurface& s) {
+                        return binOf(s) <= splitBin; });
+                size_t midSurf = midIt - _searchSurfaces.begin();
+
+                buildNode(begSurf, midSurf);
+                buildNode(midSurf, endSurf);
+
+                _searchNodes[nodeId].begSurf = begSurf;
+                _searchNodes[nodeId].endSurf = begSurf;
+                _searchNodes[nodeId].endNode = _searchNodes.size();
+                return;
+            }
+        }
+
+        if(surfCount <= BVH_MAX_LEAF_SIZE)
+            return;
+
+        // Degenerate centroids : fall back on a median split
+        size_t midSurf = begSurf + surfCount / 2;
+        buildNode(begSurf, midSurf);
+        buildNode(midSurf, endSurf);
+
+        _searchNodes[nodeId].begSurf = begSurf;
+        _searchNodes[nodeId].endSurf = begSurf;
+        _searchNodes[nodeId].endNode = _searchNodes.size();
     }
 }
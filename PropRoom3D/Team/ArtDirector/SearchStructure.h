@@ -1,11 +1,14 @@
 #ifndef PROPROOM3D_SEARCHSTRUCTURE_H
 #define PROPROOM3D_SEARCHSTRUCTURE_H
 
+#include <map>
 #include <vector>
 #include <memory>
-#include <atomic>
 
-#include <PropRoom3D/libPropRoom3D_global.h>
+#include <PropRoom3D/Ray/AxisAlignedBox.h>
+
+#include "SurfaceProgram.h"
+#include "LightTree.h"
 
 
 namespace prop3
@@ -16,6 +19,7 @@ namespace prop3
     class Raycast;
     class RayHitList;
     class RayHitReport;
+    class RayPacket;
 
     class AbstractTeam;
 
@@ -26,49 +30,100 @@ namespace prop3
 		size_t endZone;
 		size_t begSurf;
 		size_t endSurf;
+		size_t begNode;
+		size_t endNode;
 		Surface* bounds;
 	};
 
-	struct SearchSurface
+	// Bounding volume hierarchy node. Nodes of a zone are stored
+	// in depth-first order : endNode is the first node past this
+	// node's subtree. Only leaves reference surfaces.
+	struct SearchNode
 	{
-		SearchSurface(const std::shared_ptr<Surface>& surface) :
-			surface(surface), hitCount(0) {}
-
-		SearchSurface(const SearchSurface& search) :
-			surface(search.surface), hitCount(search.hitCount.load()) {}
+		AxisAlignedBox bounds;
+		size_t endNode;
+		size_t begSurf;
+		size_t endSurf;
+	};
 
-		SearchSurface(SearchSurface&& search) :
-			surface(search.surface), hitCount(search.hitCount.load()) {}
+	struct SearchSurface
+	{
+		SearchSurface(const std::shared_ptr<Surface>& surface,
+					  const AxisAlignedBox& bounds) :
+			surface(surface), bounds(bounds), hitCount(0)
+			{ program.compile(surface); }
 
 		inline Surface* operator -> () const { return surface.get(); }
 
-		inline SearchSurface& operator=(const SearchSurface& ss)
-		{
-			surface = ss.surface;
-			hitCount.store(ss.hitCount.load());
-			return *this;
-		}
-
 		std::shared_ptr<Surface> surface;
-		mutable std::atomic_long hitCount;
+		AxisAlignedBox bounds;
+		SurfaceProgram program;
+
+		// Sum of workers' counters, as of the last reduction
+		long hitCount;
 	};
 
-    class PROP3D_EXPORT SearchStructure
+	// Hit counts of a single worker, indexed like search surfaces.
+	// Each worker owns its array so that counting never contends.
+	typedef std::vector<long> HitCounters;
+
+    class PROP3D_EXPORT SearchStructure :
+            public std::enable_shared_from_this<SearchStructure>
     {
     public:
         SearchStructure(const std::string& stageStream);
         ~SearchStructure();
 
+        // Copy for workers of another NUMA node. Its memory is first
+        // touched, thus placed, by the calling thread. Surfaces are
+        // shared and hit counters created by the replica are reduced
+        // by this structure. Replicas don't follow later changes.
+        std::shared_ptr<SearchStructure> replicate();
+
         double findNearestIntersection(
                 const Raycast& raycast,
                 RayHitReport& reportMin,
-                RayHitList& rayHitList) const;
+                RayHitList& rayHitList,
+                HitCounters* hitCounters) const;
+
+        // Packet version of findNearestIntersection. Lanes' limits are
+        // narrowed down to their nearest hit, reported in reportMins.
+        void findNearestIntersections(
+                RayPacket& packet,
+                RayHitReport* reportMins,
+                RayHitList& rayHitList,
+                HitCounters* hitCounters) const;
 
         bool intersectsScene(
                 const Raycast& raycast,
                 RayHitList& rayHitList,
+                HitCounters* hitCounters,
                 double incomingEntropy) const;
 
+        // Any-hit query that tests occluder first, the search surface
+        // that blocked a previous related ray. Occluder is then set to
+        // the surface that blocked this ray, if any.
+        bool intersectsScene(
+                const Raycast& raycast,
+                RayHitList& rayHitList,
+                HitCounters* hitCounters,
+                double incomingEntropy,
+                size_t& occluder) const;
+
+        // Counters handed to a worker. Queries given null counters
+        // are not counted. Counters are tracked until their worker
+        // releases them, e.g. when it registers to a new structure.
+        std::shared_ptr<HitCounters> createHitCounters();
+
+        // Sums workers' counters into search surfaces, then clears
+        // them. Workers must not be tracing meanwhile.
+        void reduceHitCounters();
+
+        // Surface count per power of two bin of reduced hit counts.
+        // Bin 0 holds never hit surfaces and bin i counts in the
+        // range [2^(i-1), 2^i).
+        void visibilityHistogram(std::vector<unsigned int>& bins) const;
+
         void removeHiddenSurfaces(
                 int threshold,
                 size_t& removedZones,
@@ -85,21 +140,52 @@ namespace prop3
 
         const std::vector<std::shared_ptr<const LightBulb>>& lights() const;
 
+        // Refers to lights by their index in lights()
+        const LightTree& lightTree() const;
+
+        // Index in lights(), or LightTree::NO_LIGHT
+        size_t lightId(const LightBulb* light) const;
+
+
+        static const size_t NO_OCCLUDER;
+
 
     protected:
+        SearchStructure(const std::shared_ptr<SearchStructure>& master);
+
+        // Counters still held by workers. Released ones are dropped.
+        std::vector<std::shared_ptr<HitCounters>> liveHitCounters();
+
         void incrementCounter(
-                const SearchSurface& surf,
+                HitCounters* hitCounters,
+                size_t surfId,
                 double entropy) const;
 
+        // Unlinks the nearest report closer than limit from the list.
+        // Traversal holds on to it so that only the final closest
+        // hit gets copied out.
+        static RayHitReport* takeNearest(
+                RayHitList& reports,
+                double limit);
+
+        // Surface area heuristic BVH construction
+        void buildHierarchy(SearchZone& zone);
+        void buildNode(size_t begSurf, size_t endSurf);
+
     private:
         // Main Structures
         std::shared_ptr<AbstractTeam> _team;
         std::vector<SearchZone> _searchZones;
+        std::vector<SearchNode> _searchNodes;
         std::vector<SearchSurface> _searchSurfaces;
+        std::vector<std::weak_ptr<HitCounters>> _hitCounters;
 
         bool _isEmpty;
         bool _isOptimized;
         std::vector<std::shared_ptr<const LightBulb>> _lights;
+        LightTree _lightTree;
+        std::map<const LightBulb*, size_t> _lightIds;
+        std::shared_ptr<SearchStructure> _master;
     };
 
 
@@ -124,6 +210,11 @@ namespace prop3
     {
         return _lights;
     }
+
+    inline const LightTree& SearchStructure::lightTree() const
+    {
+        return _lightTree;
+    }
 }
 
 #endif // PROPROOM3D_SEARCHSTRUCTURE_H
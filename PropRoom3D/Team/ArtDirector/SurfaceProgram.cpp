@@ -0,0 +1,714 @@
+#include "SurfaceProgram.h"
+
+#include <algorithm>
+
+#include "Node/Visitor.h"
+#include "Ray/Raycast.h"
+#include "Ray/RayHitList.h"
+#include "Ray/RayHitReport.h"
+
+
+namespace prop3
+{
+    const size_t MAX_CROSSING_COUNT = 256;
+    const size_t MAX_STATE_COUNT = 64;
+
+
+    struct SurfaceProgram::Crossing
+    {
+        double length;
+        RayHitReport* report;
+        unsigned int child;
+        bool insideBefore;
+        bool toggles;
+        bool reportable;
+    };
+
+    struct SurfaceProgram::CrossingBuffer
+    {
+        CrossingBuffer() :
+            count(0), stateCount(0), overflow(false),
+            anyHitOp(-1), anyHit(false) {}
+
+        Crossing crossings[MAX_CROSSING_COUNT];
+        bool states[MAX_STATE_COUNT];
+        size_t count;
+        size_t stateCount;
+        bool overflow;
+
+        // Sweeping this operation stops at its first boundary crossing
+        size_t anyHitOp;
+        bool anyHit;
+    };
+
+    // Lowers a surface tree into a program's operations
+    class SurfaceCompiler : public Visitor
+    {
+    public:
+        SurfaceCompiler(SurfaceProgram& program) :
+            _program(program),
+            _transform(-1)
+        {
+        }
+
+        void compile(Surface& surface)
+        {
+            _isLogical = false;
+            surface.accept(*this);
+
+            if(!_isLogical)
+            {
+                std::shared_ptr<Surface> baked = bake(surface);
+                if(baked.get() != nullptr)
+                {
+                    // The copy carries the shells' transform and materials
+                    size_t opId = emit(SurfaceProgram::EOpCode::PRIMITIVE, *baked, -1);
+                    SurfaceProgram::Op& op = _program._ops[opId];
+                    op.primitive = baked.get();
+                    op.isSolid = !baked->interiorBoundingBox().isEmpty();
+                    _program._bakedSurfaces.push_back(baked);
+                }
+                else
+                {
+                    size_t opId = emit(SurfaceProgram::EOpCode::PRIMITIVE, surface, _transform);
+                    SurfaceProgram::Op& op = _program._ops[opId];
+                    op.primitive = &surface;
+                    op.isSolid = !surface.interiorBoundingBox().isEmpty();
+                    op.transform = _transform;
+                    op.coating = _coating.get();
+                    op.innerMat = _innerMat.get();
+                    op.outerMat = _outerMat.get();
+                }
+            }
+        }
+
+        virtual void visit(SurfaceShell& node) override
+        {
+            glm::dmat4 mv = node.transform();
+            if(_transform != -1)
+                mv = _program._transforms[_transform].mvTransform * mv;
+
+            SurfaceProgram::OpTransform transform;
+            transform.mvTransform = mv;
+            transform.invTransform = glm::inverse(mv);
+            transform.normalTransform = glm::transpose(
+                glm::inverse(glm::dmat3(mv)));
+            _program._transforms.push_back(transform);
+
+            int parentTransform = _transform;
+            std::shared_ptr<Coating> parentCoating = _coating;
+            std::shared_ptr<Material> parentInnerMat = _innerMat;
+            std::shared_ptr<Material> parentOuterMat = _outerMat;
+
+            // Outermost shells have the final word on materials
+            _transform = int(_program._transforms.size() - 1);
+            if(_coating.get() == nullptr) _coating = node.coating();
+            if(_innerMat.get() == nullptr) _innerMat = node.innerMaterial();
+            if(_outerMat.get() == nullptr) _outerMat = node.outerMaterial();
+
+            compile(*child(node, 0));
+
+            _transform = parentTransform;
+            _coating = parentCoating;
+            _innerMat = parentInnerMat;
+            _outerMat = parentOuterMat;
+
+            // Set last : compiling the child resets the flag
+            _isLogical = true;
+        }
+
+        virtual void visit(SurfaceGhost& node) override
+        {
+            compileLogical(SurfaceProgram::EOpCode::GHOST, node);
+        }
+
+        virtual void visit(SurfaceInverse& node) override
+        {
+            compileLogical(SurfaceProgram::EOpCode::INVERSE, node);
+        }
+
+        virtual void visit(SurfaceOr& node) override
+        {
+            compileLogical(SurfaceProgram::EOpCode::OR, node);
+        }
+
+        virtual void visit(SurfaceAnd& node) override
+        {
+            compileLogical(SurfaceProgram::EOpCode::AND, node);
+        }
+
+    private:
+        static std::shared_ptr<Surface> child(Surface& node, size_t i)
+        {
+            return std::static_pointer_cast<Surface>(node.children()[i]);
+        }
+
+        void compileLogical(SurfaceProgram::EOpCode code, Surface& node)
+        {
+            size_t opId = emit(code, node, _transform);
+
+            std::vector<std::shared_ptr<Node>> children = node.children();
+            for(size_t c=0; c < children.size(); ++c)
+                compile(*child(node, c));
+
+            SurfaceProgram::Op& op = _program._ops[opId];
+            op.endOp = _program._ops.size();
+
+            op.crossingBounds = AxisAlignedBox();
+            for(size_t c=opId+1; c < op.endOp; c = _program._ops[c].endOp)
+                op.crossingBounds.extend(_program._ops[c].crossingBounds);
+            op.testCrossingBounds = SurfaceProgram::isCullable(op.crossingBounds);
+
+            _isLogical = true;
+        }
+
+        // Copy of a primitive with the enclosing shells applied, or
+        // nullptr when the primitive can't absorb their transform
+        std::shared_ptr<Surface> bake(const Surface& surface) const
+        {
+            if(_transform == -1 || !surface.isAffineTransformable())
+                return std::shared_ptr<Surface>();
+
+            std::shared_ptr<Surface> baked = surface.clone();
+            if(baked.get() == nullptr)
+                return baked;
+
+            applyTransformation(baked, Transform(
+                _program._transforms[_transform].mvTransform));
+
+            if(_coating.get() != nullptr) baked->setCoating(_coating);
+            if(_innerMat.get() != nullptr) baked->setInnerMaterial(_innerMat);
+            if(_outerMat.get() != nullptr) baked->setOuterMaterial(_outerMat);
+
+            return baked;
+        }
+
+        size_t emit(SurfaceProgram::EOpCode code, const Surface& node, int transform)
+        {
+            SurfaceProgram::Op op;
+            op.code = code;
+            op.endOp = _program._ops.size() + 1;
+            op.primitive = nullptr;
+            op.isSolid = false;
+            op.transform = -1;
+            op.coating = nullptr;
+            op.innerMat = nullptr;
+            op.outerMat = nullptr;
+
+            op.bounds = node.boundingBox();
+            op.interiorBounds = node.interiorBoundingBox();
+            if(transform != -1)
+            {
+                const glm::dmat4& mv =
+                    _program._transforms[transform].mvTransform;
+                op.bounds = op.bounds.transformed(mv);
+                op.interiorBounds = op.interiorBounds.transformed(mv);
+            }
+
+            op.testBounds = SurfaceProgram::isCullable(op.bounds);
+            op.crossingBounds = op.bounds;
+            op.testCrossingBounds = op.testBounds;
+
+            _program._ops.push_back(op);
+            return _program._ops.size() - 1;
+        }
+
+        SurfaceProgram& _program;
+        bool _isLogical;
+        int _transform;
+        std::shared_ptr<Coating> _coating;
+        std::shared_ptr<Material> _innerMat;
+        std::shared_ptr<Material> _outerMat;
+    };
+
+
+    SurfaceProgram::SurfaceProgram()
+    {
+
+    }
+
+    void SurfaceProgram::compile(const std::shared_ptr<Surface>& surface)
+    {
+        _ops.clear();
+        _transforms.clear();
+        _bakedSurfaces.clear();
+
+        if(surface.get() != nullptr)
+        {
+            SurfaceCompiler compiler(*this);
+            compiler.compile(*surface);
+        }
+    }
+
+    EPointPosition SurfaceProgram::isIn(size_t opId, const glm::dvec3& point) const
+    {
+        const Op& op = _ops[opId];
+
+        switch(op.code)
+        {
+        case EOpCode::PRIMITIVE :
+            if(op.transform == -1)
+                return op.primitive->isIn(point);
+            else
+                return op.primitive->isIn(glm::dvec3(
+                    _transforms[op.transform].invTransform *
+                    glm::dvec4(point, 1.0)));
+
+        case EOpCode::GHOST :
+            return isIn(opId + 1, point);
+
+        case EOpCode::INVERSE :
+        {
+            EPointPosition pos = isIn(opId + 1, point);
+            return pos != EPointPosition::IN ?
+                    pos == EPointPosition::OUT ?
+                        EPointPosition::IN :
+                        EPointPosition::ON :
+                        EPointPosition::OUT;
+        }
+
+        case EOpCode::OR :
+        {
+            EPointPosition pos = EPointPosition::OUT;
+            for(size_t c = opId + 1; c < op.endOp; c = _ops[c].endOp)
+            {
+                EPointPosition childPos = isIn(c, point);
+                if(childPos == EPointPosition::IN)
+                    return EPointPosition::IN;
+                else if(childPos == EPointPosition::ON)
+                    pos = EPointPosition::ON;
+            }
+            return pos;
+        }
+
+        case EOpCode::AND :
+        {
+            EPointPosition pos = EPointPosition::IN;
+            for(size_t c = opId + 1; c < op.endOp; c = _ops[c].endOp)
+            {
+                EPointPosition childPos = isIn(c, point);
+                if(childPos == EPointPosition::OUT)
+                    return EPointPosition::OUT;
+                else if(childPos == EPointPosition::ON)
+                    pos = EPointPosition::ON;
+            }
+            return pos;
+        }
+        }
+
+        return EPointPosition::OUT;
+    }
+
+    void SurfaceProgram::raycast(size_t opId, const Raycast& ray, RayHitList& reports) const
+    {
+        const Op& op = _ops[opId];
+
+        if(op.testBounds && (op.bounds.isEmpty() || !op.bounds.intersects(ray)))
+            return;
+
+        switch(op.code)
+        {
+        case EOpCode::PRIMITIVE :
+            raycastPrimitive(op, ray, reports);
+            break;
+
+        case EOpCode::GHOST :
+            // Never generates intersection points
+            break;
+
+        case EOpCode::INVERSE :
+        {
+            RayHitReport* last = reports.head;
+            raycast(opId + 1, ray, reports);
+            RayHitReport* node = reports.head;
+
+            while(node != last)
+            {
+                node->normal = -node->normal;
+                node = node->_next;
+            }
+            break;
+        }
+
+        case EOpCode::OR :
+        case EOpCode::AND :
+            merge(opId, ray, reports);
+            break;
+        }
+    }
+
+    void SurfaceProgram::raycastPrimitive(
+            const Op& op,
+            const Raycast& ray,
+            RayHitList& reports) const
+    {
+        if(op.transform == -1)
+        {
+            op.primitive->raycast(ray, reports);
+        }
+        else
+        {
+            RayHitReport* last = reports.head;
+            op.primitive->raycast(toPrimitive(op, ray), reports);
+            RayHitReport* node = reports.head;
+
+            const OpTransform& transform = _transforms[op.transform];
+            while(node != last)
+            {
+                RayHitReport& r = *node;
+                r.position = glm::dvec3(transform.mvTransform * glm::dvec4(r.position, 1.0));
+                r.normal = glm::normalize(transform.normalTransform * r.normal);
+
+                if(op.coating != nullptr)
+                    r.coating = op.coating;
+                if(op.innerMat != nullptr)
+                    r.innerMat = op.innerMat;
+                if(op.outerMat != nullptr)
+                    r.outerMat = op.outerMat;
+
+                node = node->_next;
+            }
+        }
+    }
+
+    void SurfaceProgram::merge(size_t opId, const Raycast& ray, RayHitList& reports) const
+    {
+        CrossingBuffer buffer;
+        crossings(opId, ray, reports, buffer);
+
+        if(!buffer.overflow)
+        {
+            for(size_t i=0; i < buffer.count; ++i)
+            {
+                const Crossing& c = buffer.crossings[i];
+                if(c.reportable)
+                    reports.add(c.report);
+                else
+                    reports.dispose(c.report);
+            }
+        }
+        else
+        {
+            for(size_t i=0; i < buffer.count; ++i)
+                reports.dispose(buffer.crossings[i].report);
+
+            // Too many crossings : classify hits one by one
+            const Op& op = _ops[opId];
+            EPointPosition rejected = (op.code == EOpCode::OR ?
+                EPointPosition::IN : EPointPosition::OUT);
+
+            for(size_t c = opId + 1; c < op.endOp; c = _ops[c].endOp)
+            {
+                RayHitReport* last = reports.head;
+                raycast(c, ray, reports);
+                filter(opId, c, rejected, last, reports);
+            }
+        }
+    }
+
+    bool SurfaceProgram::crossings(
+            size_t opId,
+            const Raycast& ray,
+            RayHitList& reports,
+            CrossingBuffer& buffer) const
+    {
+        const Op& op = _ops[opId];
+        size_t begin = buffer.count;
+
+        // The boundary is out of reach, the ray stays on the same side
+        if(op.testCrossingBounds && (op.crossingBounds.isEmpty() ||
+                                     !op.crossingBounds.intersects(ray)))
+            return isOriginIn(opId, ray);
+
+        switch(op.code)
+        {
+        case EOpCode::PRIMITIVE :
+        {
+            RayHitReport* last = reports.head;
+            raycastPrimitive(op, ray, reports);
+
+            // Hits are held by the buffer until merged
+            RayHitReport* node = reports.head;
+            reports.head = last;
+
+            bool inside = false;
+            double nearest = Raycast::BACKDROP_LIMIT;
+            while(node != last)
+            {
+                RayHitReport* next = node->_next;
+
+                if(buffer.count < MAX_CROSSING_COUNT)
+                {
+                    // Surface normals point outward
+                    Crossing& c = buffer.crossings[buffer.count++];
+                    c.length = node->length;
+                    c.report = node;
+                    c.child = 0;
+                    c.insideBefore = op.isSolid &&
+                        glm::dot(node->normal, ray.direction) > 0.0;
+                    c.toggles = op.isSolid;
+                    c.reportable = true;
+
+                    if(c.length <= nearest)
+                    {
+                        nearest = c.length;
+                        inside = c.insideBefore;
+                    }
+                }
+                else
+                {
+                    buffer.overflow = true;
+                    reports.dispose(node);
+                }
+
+                node = next;
+            }
+
+            if(begin == buffer.count)
+                inside = isOriginIn(opId, ray);
+
+            return inside;
+        }
+
+        case EOpCode::GHOST :
+        {
+            // Ghost boundaries still delimit intervals
+            bool inside = crossings(opId + 1, ray, reports, buffer);
+            for(size_t i=begin; i < buffer.count; ++i)
+                buffer.crossings[i].reportable = false;
+            return inside;
+        }
+
+        case EOpCode::INVERSE :
+        {
+            bool inside = !crossings(opId + 1, ray, reports, buffer);
+            for(size_t i=begin; i < buffer.count; ++i)
+            {
+                Crossing& c = buffer.crossings[i];
+                c.insideBefore = !c.insideBefore;
+                c.report->normal = -c.report->normal;
+            }
+            return inside;
+        }
+
+        case EOpCode::OR :
+        case EOpCode::AND :
+        {
+            size_t stateBegin = buffer.stateCount;
+            unsigned int childCount = 0;
+            for(size_t c = opId + 1; c < op.endOp; c = _ops[c].endOp)
+            {
+                if(buffer.stateCount == MAX_STATE_COUNT)
+                {
+                    buffer.overflow = true;
+                    return false;
+                }
+
+                size_t childBegin = buffer.count;
+                bool childInside = crossings(c, ray, reports, buffer);
+                buffer.states[buffer.stateCount++] = childInside;
+
+                for(size_t i=childBegin; i < buffer.count; ++i)
+                    buffer.crossings[i].child = childCount;
+                ++childCount;
+            }
+
+            if(buffer.overflow)
+                return false;
+
+            bool isOr = (op.code == EOpCode::OR);
+
+            unsigned int insideCount = 0;
+            for(unsigned int c=0; c < childCount; ++c)
+                if(buffer.states[stateBegin + c])
+                    ++insideCount;
+
+            bool inside = isOr ? insideCount > 0 : insideCount == childCount;
+
+            std::sort(buffer.crossings + begin,
+                      buffer.crossings + buffer.count,
+                      compareCrossings);
+
+            // Sweep crossings in order. A child's crossing is on the
+            // operation's boundary when the other children are all
+            // OUT (union) or all IN (intersection).
+            size_t kept = begin;
+            for(size_t i=begin; i < buffer.count; ++i)
+            {
+                Crossing c = buffer.crossings[i];
+                bool& childState = buffer.states[stateBegin + c.child];
+
+                bool before = childState;
+                bool after = c.toggles ? !c.insideBefore : before;
+                unsigned int others = insideCount - (before ? 1 : 0);
+
+                bool opBefore = isOr ? insideCount > 0 :
+                                       insideCount == childCount;
+                bool keep = isOr ? others == 0 :
+                                   others == childCount - 1;
+
+                childState = after;
+                insideCount = others + (after ? 1 : 0);
+
+                if(keep && c.reportable && opId == buffer.anyHitOp)
+                {
+                    // Occlusion found, the rest of the ray doesn't matter
+                    for(size_t j=i; j < buffer.count; ++j)
+                        reports.dispose(buffer.crossings[j].report);
+
+                    buffer.anyHit = true;
+                    break;
+                }
+
+                if(keep)
+                {
+                    c.insideBefore = opBefore;
+                    buffer.crossings[kept++] = c;
+                }
+                else
+                {
+                    reports.dispose(c.report);
+                }
+            }
+
+            buffer.count = kept;
+            buffer.stateCount = stateBegin;
+
+            return inside;
+        }
+        }
+
+        return false;
+    }
+
+    bool SurfaceProgram::isOriginIn(size_t opId, const Raycast& ray) const
+    {
+        if(!_ops[opId].interiorBounds.contains(ray.origin))
+            return false;
+
+        EPointPosition pos = isIn(opId, ray.origin);
+
+        // Resolve origins laying on the boundary by looking ahead
+        if(pos == EPointPosition::ON)
+        {
+            pos = isIn(opId, ray.origin +
+                ray.direction * RayHitReport::EPSILON_LENGTH);
+        }
+
+        return pos == EPointPosition::IN;
+    }
+
+    bool SurfaceProgram::intersects(size_t opId, const Raycast& ray, RayHitList& reports) const
+    {
+        const Op& op = _ops[opId];
+
+        if(op.testBounds && (op.bounds.isEmpty() || !op.bounds.intersects(ray)))
+            return false;
+
+        switch(op.code)
+        {
+        case EOpCode::PRIMITIVE :
+            if(op.transform == -1)
+                return op.primitive->intersects(ray, reports);
+            else
+                return op.primitive->intersects(toPrimitive(op, ray), reports);
+
+        case EOpCode::GHOST :
+            return false;
+
+        case EOpCode::INVERSE :
+            return intersects(opId + 1, ray, reports);
+
+        case EOpCode::OR :
+        case EOpCode::AND :
+            return occludes(opId, ray, reports);
+        }
+
+        return false;
+    }
+
+    bool SurfaceProgram::occludes(size_t opId, const Raycast& ray, RayHitList& reports) const
+    {
+        CrossingBuffer buffer;
+        buffer.anyHitOp = opId;
+        crossings(opId, ray, reports, buffer);
+
+        // Crossings left are either not reportable or all disposed
+        for(size_t i=0; i < buffer.count; ++i)
+            reports.dispose(buffer.crossings[i].report);
+
+        if(!buffer.overflow)
+            return buffer.anyHit;
+
+        RayHitReport* head = reports.head;
+        raycast(opId, ray, reports);
+        return head != reports.head;
+    }
+
+    void SurfaceProgram::filter(
+            size_t opId,
+            size_t childId,
+            EPointPosition rejected,
+            RayHitReport* last,
+            RayHitList& reports) const
+    {
+        const Op& op = _ops[opId];
+
+        RayHitReport* node = reports.head;
+        RayHitReport* parent = nullptr;
+
+        while(node != last)
+        {
+            bool keep = true;
+            for(size_t c = opId + 1; c < op.endOp; c = _ops[c].endOp)
+            {
+                if(c != childId)
+                {
+                    if(isIn(c, node->position) == rejected)
+                    {
+                        keep = false;
+                        break;
+                    }
+                }
+            }
+
+            RayHitReport* next = node->_next;
+
+            if(keep)
+            {
+                // Keep ray hit
+                parent = node;
+            }
+            else
+            {
+                // Dispose ray hit
+                if(parent == nullptr)
+                    reports.head = next;
+                else
+                    parent->_next = next;
+
+                reports.dispose(node);
+            }
+
+            node = next;
+        }
+    }
+
+    Raycast SurfaceProgram::toPrimitive(const Op& op, const Raycast& ray) const
+    {
+        const OpTransform& transform = _transforms[op.transform];
+
+        Raycast tRay = ray;
+        tRay.origin = glm::dvec3(transform.invTransform * glm::dvec4(ray.origin, 1.0));
+        tRay.direction = glm::dvec3(transform.invTransform * glm::dvec4(ray.direction, 0.0));
+        tRay.invDir = 1.0 / tRay.direction;
+        return tRay;
+    }
+
+    bool SurfaceProgram::compareCrossings(
+            const Crossing& c1,
+            const Crossing& c2)
+    {
+        return c1.length < c2.length;
+    }
+}
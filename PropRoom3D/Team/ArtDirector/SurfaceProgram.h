@@ -0,0 +1,149 @@
+#ifndef PROPROOM3D_SURFACEPROGRAM_H
+#define PROPROOM3D_SURFACEPROGRAM_H
+
+#include <vector>
+#include <memory>
+
+#include <GLM/glm.hpp>
+
+#include <PropRoom3D/Node/Prop/Surface/Surface.h>
+#include <PropRoom3D/Ray/AxisAlignedBox.h>
+
+
+namespace prop3
+{
+    class RayHitReport;
+    class SurfaceCompiler;
+
+
+    // Surface tree lowered to a contiguous array of operations.
+    // Shell chains are composed into a single transform, which is
+    // pushed into a private copy of affine transformable primitives.
+    // Logical nodes are evaluated by the program itself, so that
+    // only primitives are reached through virtual calls.
+    // Unions and intersections merge their children's sorted
+    // boundary crossings along the ray instead of classifying
+    // every hit against every sibling.
+    class PROP3D_EXPORT SurfaceProgram
+    {
+        friend class SurfaceCompiler;
+
+    public:
+        SurfaceProgram();
+
+        void compile(const std::shared_ptr<Surface>& surface);
+
+        EPointPosition isIn(const glm::dvec3& point) const;
+        void raycast(const Raycast& ray, RayHitList& reports) const;
+        bool intersects(const Raycast& ray, RayHitList& reports) const;
+
+        size_t opCount() const;
+
+    private:
+        enum class EOpCode
+        {
+            PRIMITIVE,
+            GHOST,
+            INVERSE,
+            OR,
+            AND
+        };
+
+        // Operations are stored in depth-first order : endOp is
+        // the first operation past this operation's subtree
+        struct Op
+        {
+            EOpCode code;
+            size_t endOp;
+            AxisAlignedBox bounds;
+            AxisAlignedBox interiorBounds;
+            bool testBounds;
+
+            // Where the inside state may change : ghosted
+            // boundaries flip it without reporting any hit
+            AxisAlignedBox crossingBounds;
+            bool testCrossingBounds;
+
+            // Primitives only
+            const Surface* primitive;
+            bool isSolid;
+            int transform;
+            const Coating* coating;
+            const Material* innerMat;
+            const Material* outerMat;
+        };
+
+        struct OpTransform
+        {
+            glm::dmat4 invTransform;
+            glm::dmat4 mvTransform;
+            glm::dmat3 normalTransform;
+        };
+
+        struct Crossing;
+        struct CrossingBuffer;
+
+        EPointPosition isIn(size_t opId, const glm::dvec3& point) const;
+        void raycast(size_t opId, const Raycast& ray, RayHitList& reports) const;
+        bool intersects(size_t opId, const Raycast& ray, RayHitList& reports) const;
+        void raycastPrimitive(const Op& op, const Raycast& ray, RayHitList& reports) const;
+
+        // Interval evaluation : appends the sorted crossings of an
+        // operation's boundary and returns if the ray starts inside
+        void merge(size_t opId, const Raycast& ray, RayHitList& reports) const;
+        bool crossings(size_t opId, const Raycast& ray, RayHitList& reports,
+                       CrossingBuffer& buffer) const;
+        bool isOriginIn(size_t opId, const Raycast& ray) const;
+
+        // Any-hit query : stops at the first crossing of the boundary
+        bool occludes(size_t opId, const Raycast& ray, RayHitList& reports) const;
+        static bool compareCrossings(const Crossing& c1, const Crossing& c2);
+
+        // Per-hit classification, used when crossings overflow
+        void filter(size_t opId, size_t childId, EPointPosition rejected,
+                    RayHitReport* last, RayHitList& reports) const;
+
+        Raycast toPrimitive(const Op& op, const Raycast& ray) const;
+        static bool isCullable(const AxisAlignedBox& box);
+
+        std::vector<Op> _ops;
+        std::vector<OpTransform> _transforms;
+
+        // Copies of primitives that absorbed their shells' transform
+        std::vector<std::shared_ptr<Surface>> _bakedSurfaces;
+    };
+
+
+
+    // IMPLEMENTATION //
+    inline size_t SurfaceProgram::opCount() const
+    {
+        return _ops.size();
+    }
+
+    inline bool SurfaceProgram::isCullable(const AxisAlignedBox& box)
+    {
+        // Unbounded in every direction : nothing to cull
+        return box.isEmpty() ||
+            !(glm::all(glm::isinf(box.minCorner)) &&
+              glm::all(glm::isinf(box.maxCorner)));
+    }
+
+    inline EPointPosition SurfaceProgram::isIn(const glm::dvec3& point) const
+    {
+        return _ops.empty() ? EPointPosition::OUT : isIn(0, point);
+    }
+
+    inline void SurfaceProgram::raycast(const Raycast& ray, RayHitList& reports) const
+    {
+        if(!_ops.empty())
+            raycast(0, ray, reports);
+    }
+
+    inline bool SurfaceProgram::intersects(const Raycast& ray, RayHitList& reports) const
+    {
+        return !_ops.empty() && intersects(0, ray, reports);
+    }
+}
+
+#endif // PROPROOM3D_SURFACEPROGRAM_H